@@ -36,7 +36,7 @@ long loc;
 	void attack_city();
 	void attack_obj();
 	
-	if (map[loc].contents == '*') /* attacking a city? */
+	if (game->map[loc].contents == '*') /* attacking a city? */
 		attack_city (att_obj, loc);
 	else attack_obj (att_obj, loc); /* attacking a piece */
 }
@@ -68,7 +68,7 @@ long loc;
 	}
 	else { /* attack succeeded */
 		kill_city (cityp);
-		cityp->owner = att_owner;
+		set_city_owner (cityp, att_owner);
 		kill_obj (att_obj, loc);
 
 		if (att_owner == USER) {
@@ -108,11 +108,15 @@ long loc;
 	
 	if (def_obj->type == SATELLITE) return; /* can't attack a satellite */
 
+	hash_piece (att_obj);
+	hash_piece (def_obj);
 	while (att_obj->hits > 0 && def_obj->hits > 0) {
 		if (irand (2) == 0) /* defender hits? */
 		     att_obj->hits -= piece_attr[def_obj->type].strength;
 		else def_obj->hits -= piece_attr[att_obj->type].strength;
 	}
+	hash_piece (att_obj);
+	hash_piece (def_obj);
 
 	if (att_obj->hits > 0) { /* attacker won? */
 		describe (att_obj, def_obj, loc);
@@ -142,8 +146,8 @@ survive (obj, loc)
 piece_info_t *obj;
 long loc;
 {
-	while (obj_capacity (obj) < obj->count)
-		kill_obj (obj->cargo, loc);
+	while (obj_capacity (obj) < LINKS(obj)->count)
+		kill_obj (OBJ(LINKS(obj)->cargo), loc);
 		
 	move_obj (obj, loc);
 }
@@ -168,8 +172,8 @@ long loc;
 			ksend1 ("Your %s has %d hits left\n",piece_attr[win_obj->type].name,win_obj->hits,0,0,0,0,0,0); //kermyt
 			topmsg1 (2, "Your %s has %d hits left.", piece_attr[win_obj->type].name, win_obj->hits,0,0,0,0,0,0);
 				
-			diff = win_obj->count - obj_capacity (win_obj);
-			if (diff > 0) switch (win_obj->cargo->type) {
+			diff = LINKS(win_obj)->count - obj_capacity (win_obj);
+			if (diff > 0) switch (OBJ(LINKS(win_obj)->cargo)->type) {
 			case ARMY:
 				ksend("%d armies fell overboard and drowned in the assault.\n",diff,0,0,0,0,0,0,0); //kermyt
 			     topmsg (3,"%d armies fell overboard and drowned in the assault.",diff,0,0,0,0,0,0,0);
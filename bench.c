@@ -0,0 +1,317 @@
+/* %W% %G% %U% - (c) Copyright 1987, 1988 Chuck Simmons */
+
+/*
+ *    Copyright (C) 1987, 1988 Chuck Simmons
+ *
+ * See the file COPYING, distributed with empire, for restriction
+ * and warranty information.
+ */
+
+/*
+bench.c -- time the map searching primitives against saved games.
+
+usage: vms-empire-bench [-n reps] [-s stride] [dir ...]
+
+    -n reps:   number of times each primitive is run from each start
+               location.  Default is 1.
+
+    -s stride: only every stride'th on board location is used as a
+               start location.  Default is 7.
+
+Each directory must hold an 'empsave.dat'; if none are given, the
+current directory is used.  Keeping saves of different ages in
+different directories lets us see how the searches behave as the
+computer's view of the world fills in.
+
+For each primitive we report the number of calls, the average time
+per call, and the average number of cells expanded per call, as
+counted by 'expand_count'.  The last line times a rollout (see
+rollout.c) of ten turns from the saved position.
+*/
+
+#ifdef SYSV
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "empire.h"
+#include "extern.h"
+
+#define OPTFLAGS "n:s:"
+
+typedef struct {
+	long calls; /* number of calls timed */
+	long nsec; /* total time spent in calls */
+	long cells; /* total cells expanded */
+} bench_t;
+
+#define B_LOBJ 0
+#define B_WOBJ 1
+#define B_AOBJ 2
+#define B_LWOBJ 3
+#define B_WLOBJ 4
+#define B_DEST 5
+#define B_CONT 6
+#define B_PRUNE 7
+#define B_PATH 8
+#define B_ROLLOUT 9
+#define NUM_BENCH 10
+
+#define ROLLOUT_TURNS 10 /* length of a timed rollout */
+
+static bench_t bench[NUM_BENCH];
+static char *bench_name[NUM_BENCH] = {
+	"vmap_find_lobj", "vmap_find_wobj", "vmap_find_aobj",
+	"vmap_find_lwobj", "vmap_find_wlobj", "vmap_find_dest",
+	"vmap_cont+scan", "vmap_prune_explore_locs", "vmap_mark_path",
+	"rollout (10 turns)"
+};
+
+static path_map_t *pmap; /* these are sized for the restored map */
+static int *cont_map;
+static view_map_t *xmap; /* scratch copy of a view map */
+static view_map_t *army_map; /* army load map */
+static view_map_t *tt_map; /* transport load map */
+static int bench_cells; /* cells allocated in the maps above */
+
+static long start_nsec; /* time and count when current call began */
+static long start_count;
+
+/* Return a monotonic time stamp in nanoseconds. */
+
+static long
+nsec_now ()
+{
+	struct timespec ts;
+
+	(void) clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (long)ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+static void
+bench_start ()
+{
+	start_count = expand_count;
+	start_nsec = nsec_now ();
+}
+
+static void
+bench_end (b)
+int b;
+{
+	bench[b].nsec += nsec_now () - start_nsec;
+	bench[b].cells += expand_count - start_count;
+	bench[b].calls += 1;
+}
+
+/*
+Make the scratch maps big enough for the game just restored.
+Returns FALSE if there is no memory.
+*/
+
+static int
+bench_alloc ()
+{
+	if (MAP_SIZE <= bench_cells) return (TRUE);
+
+	free ((char *)pmap);
+	free ((char *)cont_map);
+	free ((char *)xmap);
+	free ((char *)army_map);
+	free ((char *)tt_map);
+	pmap = (path_map_t *) malloc (MAP_SIZE * sizeof (path_map_t));
+	cont_map = (int *) malloc (MAP_SIZE * sizeof (int));
+	xmap = (view_map_t *) malloc (MAP_SIZE * sizeof (view_map_t));
+	army_map = (view_map_t *) malloc (MAP_SIZE * sizeof (view_map_t));
+	tt_map = (view_map_t *) malloc (MAP_SIZE * sizeof (view_map_t));
+	if (pmap == NULL || cont_map == NULL || xmap == NULL
+	 || army_map == NULL || tt_map == NULL) {
+		bench_cells = 0;
+		return (FALSE);
+	}
+	bench_cells = MAP_SIZE;
+	return (TRUE);
+}
+
+/*
+Time each primitive starting from one location.  Land searches
+start on land, water searches start on water.
+*/
+
+static void
+bench_loc (loc, dest, reps)
+long loc;
+long dest; /* another start location, used as a destination */
+int reps;
+{
+	int i;
+	long found;
+	char c;
+
+	c = comp_map[loc].contents;
+
+	for (i = 0; i < reps; i++) {
+		if (c == '+') {
+			bench_start ();
+			(void) vmap_find_lobj (pmap, comp_map, loc, &army_fight);
+			bench_end (B_LOBJ);
+
+			bench_start ();
+			(void) vmap_find_lwobj (pmap, army_map, loc, &army_load, INFINITY);
+			bench_end (B_LWOBJ);
+
+			bench_start ();
+			vmap_cont (cont_map, comp_map, loc, '.');
+			(void) vmap_cont_scan (cont_map, comp_map);
+			bench_end (B_CONT);
+		}
+		if (c == '.') {
+			bench_start ();
+			(void) vmap_find_wobj (pmap, comp_map, loc, &ship_fight);
+			bench_end (B_WOBJ);
+
+			bench_start ();
+			(void) vmap_find_wlobj (pmap, tt_map, loc, &tt_load);
+			bench_end (B_WLOBJ);
+		}
+		bench_start ();
+		(void) vmap_find_aobj (pmap, comp_map, loc, &fighter_fight);
+		bench_end (B_AOBJ);
+
+		bench_start ();
+		found = vmap_find_dest (pmap, comp_map, loc, dest, COMP, T_AIR);
+		bench_end (B_DEST);
+
+		if (found != loc) { /* path exists; mark it */
+			bench_start ();
+			vmap_mark_path (pmap, comp_map, found);
+			bench_end (B_PATH);
+		}
+	}
+}
+
+/*
+Run the benchmarks against the game saved in the current directory.
+*/
+
+static void
+bench_game (reps, stride)
+int reps;
+int stride;
+{
+	piece_info_t dummy;
+	long loc, prev;
+	int i;
+
+	if (!restore_game ()) return;
+	if (!bench_alloc ()) {
+		(void) printf ("empire: not enough memory for the benchmarks.\n");
+		return;
+	}
+
+	/* build the load maps the way the computer does */
+	(void) bzero ((char *)&dummy, sizeof (dummy)); /* army not loading */
+	make_army_load_map (&dummy, army_map, comp_map);
+	make_tt_load_map (tt_map, comp_map);
+
+	prev = -1;
+	for (loc = 0; loc < MAP_SIZE; loc += stride)
+	if (ON_BOARD (loc) && comp_map[loc].contents != ' ') {
+		if (prev != -1) bench_loc (loc, prev, reps);
+		prev = loc;
+	}
+	for (i = 0; i < reps; i++) {
+		(void) memcpy ((char *)xmap, (char *)comp_map,
+				MAP_SIZE * sizeof (view_map_t));
+		bench_start ();
+		vmap_prune_explore_locs (xmap);
+		bench_end (B_PRUNE);
+
+		bench_start ();
+		(void) rollout ((int *)NULL, ROLLOUT_TURNS);
+		bench_end (B_ROLLOUT);
+	}
+}
+
+/*
+Print the results and clear them for the next game.
+*/
+
+static void
+bench_report (dir)
+char *dir;
+{
+	int i;
+
+	(void) printf ("%s: date %ld\n", dir, game->date);
+	(void) printf ("%-24s %8s %12s %12s\n",
+		"primitive", "calls", "ns/call", "cells/call");
+
+	for (i = 0; i < NUM_BENCH; i++) {
+		if (bench[i].calls == 0)
+			(void) printf ("%-24s %8d %12s %12s\n", bench_name[i], 0, "-", "-");
+		else (void) printf ("%-24s %8ld %12ld %12ld\n", bench_name[i],
+			bench[i].calls,
+			bench[i].nsec / bench[i].calls,
+			bench[i].cells / bench[i].calls);
+	}
+	(void) printf ("\n");
+	(void) bzero ((char *)bench, sizeof (bench));
+}
+
+main (argc, argv)
+int argc;
+char *argv[];
+{
+	int c;
+	extern char *optarg;
+	extern int optind;
+	int errflg = 0;
+	int reps, stride;
+	char *dir;
+	char home[1024]; /* directory we started in */
+
+	reps = 1; /* set defaults */
+	stride = 7;
+
+	while ((c = getopt (argc, argv, OPTFLAGS)) != EOF) {
+		switch (c) {
+		case 'n':
+			reps = atoi (optarg);
+			break;
+		case 's':
+			stride = atoi (optarg);
+			break;
+		case '?': /* illegal option? */
+			errflg++;
+			break;
+		}
+	}
+	if (errflg || reps < 1 || stride < 1) {
+		(void) printf ("empire: usage: vms-empire-bench [-n reps] [-s stride] [dir ...]\n");
+		exit (1);
+	}
+	game = alloc_game ();
+	if (game == NULL) {
+		(void) printf ("empire: not enough memory for a game.\n");
+		exit (1);
+	}
+	if (getcwd (home, sizeof (home)) == NULL) {
+		perror ("getcwd");
+		exit (1);
+	}
+	do {
+		dir = optind < argc ? argv[optind] : ".";
+		if (chdir (dir) != 0) perror (dir);
+		else {
+			bench_game (reps, stride);
+			bench_report (dir);
+		}
+		(void) chdir (home);
+	} while (++optind < argc);
+	return (0);
+}
@@ -27,7 +27,8 @@ For each move the user wants us to make, we do the following:
 #include "empire.h"
 #include "extern.h"
 
-static view_map_t emap[MAP_SIZE]; /* pruned explore map */
+#define emap (game->emap) /* pruned explore map */
+#define PLAN_INTERVAL 10 /* turns between reviews of production plan */
 
 int load_army(piece_info_t *obj);
 void move_objective(piece_info_t *obj,path_map_t pathmap[],long new_loc,char *adj_list);
@@ -36,28 +37,41 @@ void
 comp_move (nmoves) 
 int nmoves;
 {
-	void do_cities(), do_pieces(), check_endgame();
+	void do_cities(), do_pieces(), check_endgame(), comp_plan();
 
 	int i;
-	piece_info_t *obj;
+	long turn_start, prune_start, span;
 
-	/* Update our view of the world. */
-	
-	for (i = 0; i < NUM_OBJECTS; i++)
-	for (obj = comp_obj[i]; obj != NULL; obj = obj->piece_link.next)
-		scan (comp_map, obj->loc); /* refresh comp's view of world */
+	turn_start = phase_begin ();
+	span = trace_begin ();
+	stack_enter (ST_COMP_MOVE);
+
+	scan_changes (COMP); /* update our view of the world */
 
 	for (i = 1; i <= nmoves; i++) { /* for each move we get... */
 		comment ("Thinking...",0,0,0,0,0,0,0,0);
 
+		if (plan_horizon && game->date % PLAN_INTERVAL == 0)
+			comp_plan (); /* review production plan */
+
+		prune_start = phase_begin ();
 		(void) memcpy (emap, comp_map, MAP_SIZE * sizeof (view_map_t));
 		vmap_prune_explore_locs (emap);
+		phase_end (PH_PRUNE, prune_start);
 	
 		do_cities (); /* handle city production */
 		do_pieces (); /* move pieces */
 		
 		if (save_movie) save_movie_screen ();
 		check_endgame (); /* see if game is over */
+		if (checking && check_interval && game->date % check_interval == 0)
+			check (); /* look over everything now and then */
+
+		phase_end (PH_COMP_MOVE, turn_start);
+		trace_end ("comp_move", span, "date", game->date, NULL, 0);
+		stats_turn (); /* record the cost of this turn */
+		turn_start = phase_begin ();
+		span = trace_begin ();
 
 		topini ();
 		(void) refresh ();
@@ -85,25 +99,29 @@ do_cities () {
 	
 	int i;
 	int is_lake;
+	long start;
+
+	start = phase_begin ();
 
 	for (i = 0; i < NUM_CITY; i++) /* new production */
-	if (city[i].owner == COMP) {
-		scan (comp_map, city[i].loc);
+	if (game->city[i].owner == COMP) {
+		scan (comp_map, game->city[i].loc);
 
-		if (city[i].prod == NOPIECE)
-			comp_prod (&city[i], lake (city[i].loc));
+		if (game->city[i].prod == NOPIECE)
+			comp_prod (&game->city[i], lake (game->city[i].loc));
 	}
 	for (i = 0; i < NUM_CITY; i++) /* produce and change */
-	if (city[i].owner == COMP) {
-		is_lake = lake (city[i].loc);
-		if (city[i].work++ >= (long)piece_attr[city[i].prod].build_time) {
-			produce (&city[i]);
-			comp_prod (&city[i], is_lake);
+	if (game->city[i].owner == COMP) {
+		is_lake = lake (game->city[i].loc);
+		if (game->city[i].work++ >= (long)piece_attr[game->city[i].prod].build_time) {
+			produce (&game->city[i]);
+			comp_prod (&game->city[i], is_lake);
 		}
 		/* don't produce ships in lakes */
-		else if (city[i].prod > FIGHTER && city[i].prod != SATELLITE && is_lake)
-			comp_prod (&city[i], is_lake);
+		else if (game->city[i].prod > FIGHTER && game->city[i].prod != SATELLITE && is_lake)
+			comp_prod (&game->city[i], is_lake);
 	}
+	phase_end (PH_CITIES, start);
 }
 			
 /*
@@ -121,6 +139,39 @@ static int ratio3[NUM_OBJECTS] = {120,  20,  20,  10,  10,  60,  10,  10,  0};
 static int ratio4[NUM_OBJECTS] = {150,  30,  30,  20,  20,  70,  10,  10,  0};
 static int *ratio;
 
+/*
+Every PLAN_INTERVAL turns, if 'plan_horizon' is set, we play each
+of the ratio tables above 'plan_horizon' turns ahead (see rollout.c),
+along with the usual choice of table by number of cities, and use
+whichever did best until the next review.
+*/
+
+void
+comp_plan () {
+	static int *plans[] = {NULL, ratio1, ratio2, ratio3, ratio4};
+
+	int i, best;
+	long score, best_score;
+	long start, span;
+
+	start = phase_begin ();
+	span = trace_begin ();
+
+	best = 0;
+	best_score = 0;
+	for (i = 0; i < sizeof (plans) / sizeof (plans[0]); i++) {
+		score = rollout (plans[i], plan_horizon);
+		if (i == 0 || score > best_score) {
+			best = i;
+			best_score = score;
+		}
+	}
+	prod_plan = plans[best];
+
+	phase_end (PH_PLAN, start);
+	trace_end ("comp_plan", span, "plan", best, "score", best_score);
+}
+
 /*
 Set city production if necessary.
 
@@ -141,7 +192,7 @@ int is_lake;
 	void comp_set_prod(), comp_set_needed();
 	
 	int city_count[NUM_OBJECTS]; /* # of cities producing each piece */
-	int cont_map[MAP_SIZE];
+	int *cont_map;
 	int total_cities;
 	long i;
 	int comp_ac;
@@ -149,6 +200,9 @@ int is_lake;
 	int need_count, interest;
 	scan_counts_t counts;
 
+	stack_enter (ST_COMP_PROD);
+	cont_map = game->prod_cont;
+
 	/* Make sure we have army producers for current continent. */
 	
 	/* map out city's continent */
@@ -196,11 +250,12 @@ int is_lake;
 	total_cities = 0;
 		
 	for (i = 0; i < NUM_CITY; i++)
-	if (city[i].owner == COMP && city[i].prod != NOPIECE) {
-		city_count[city[i].prod] += 1;
+	if (game->city[i].owner == COMP && game->city[i].prod != NOPIECE) {
+		city_count[game->city[i].prod] += 1;
 		total_cities += 1;
 	}
-	if (total_cities <= 10) ratio = ratio1;
+	if (prod_plan) ratio = prod_plan; /* planner has chosen */
+	else if (total_cities <= 10) ratio = ratio1;
 	else if (total_cities <= 20) ratio = ratio2;
 	else if (total_cities <= 30) ratio = ratio3;
 	else ratio = ratio4;
@@ -218,9 +273,9 @@ int is_lake;
 		/* produce armies here instead */
 		if (city_count[ARMY] == 1) {
 			for (i = 0; i < NUM_CITY; i++)
-			if (city[i].owner == COMP && city[i].prod == ARMY) break;
+			if (game->city[i].owner == COMP && game->city[i].prod == ARMY) break;
 		
-			if (!lake (city[i].loc)) {
+			if (!lake (game->city[i].loc)) {
 				comp_set_prod (cityp, ARMY);
 				return;
 			}
@@ -361,9 +416,11 @@ int
 lake (loc)
 long loc;
 {
-	int cont_map[MAP_SIZE];
+	int *cont_map;
 	scan_counts_t counts;
 
+	stack_enter (ST_LAKE);
+	cont_map = game->lake_cont;
 	vmap_cont (cont_map, emap, loc, '+'); /* map lake */
 	counts = vmap_cont_scan (cont_map, emap);
 
@@ -374,8 +431,7 @@ long loc;
 Move all computer pieces.
 */
 
-static view_map_t amap[MAP_SIZE]; /* temp view map */
-static path_map_t path_map[MAP_SIZE];
+#define amap (game->amap) /* temp view map */
 
 void
 do_pieces () { /* move pieces */
@@ -383,12 +439,18 @@ do_pieces () { /* move pieces */
 
 	int i;
 	piece_info_t *obj, *next_obj;
+	long start, span, loc;
 
 	for (i = 0; i < NUM_OBJECTS; i++) { /* loop through obj lists */
-		for (obj = comp_obj[move_order[i]]; obj != NULL;
+		for (obj = OBJ(comp_obj[move_order[i]]); obj != NULL;
 		    obj = next_obj) { /* loop through objs in list */
-			next_obj = obj->piece_link.next;
+			next_obj = OBJ(LINKS(obj)->piece_link.next);
+			loc = obj->loc; /* obj may be gone after move */
+			start = phase_begin ();
+			span = trace_begin ();
 			cpiece_move (obj); /* yup; move the object */
+			phase_end (PH_PIECE + move_order[i], start);
+			trace_end ("cpiece_move", span, "type", move_order[i], "loc", loc);
 		}
 	}
 }
@@ -444,8 +506,11 @@ piece_info_t *obj;
 		&& !changed_loc /* object never changed location? */
 		&& obj->type != ARMY && obj->type != FIGHTER /* it is a boat? */
 		&& obj->hits != max_hits /* it is damaged? */
-		&& comp_map[obj->loc].contents == 'X') /* it is in port? */
-	obj->hits++; /* fix some damage */
+		&& comp_map[obj->loc].contents == 'X') { /* it is in port? */
+		hash_piece (obj);
+		obj->hits++; /* fix some damage */
+		hash_piece (obj);
+	}
 }
 
 /*
@@ -505,42 +570,44 @@ piece_info_t *obj;
 	void board_ship();
 	
 	long new_loc;
-	path_map_t path_map2[MAP_SIZE];
+	path_map_t *path_map2;
 	long new_loc2;
 	int cross_cost; /* cost to enter water */
 	
-	obj->func = 0; /* army doesn't want a tt */
+	stack_enter (ST_ARMY_MOVE);
+	path_map2 = game->path_map2;
+	set_func (obj, 0); /* army doesn't want a tt */
 	if (vmap_at_sea (comp_map, obj->loc)) { /* army can't move? */
 		(void) load_army (obj);
 		obj->moved = piece_attr[ARMY].speed;
-		if (!obj->ship) obj->func = 1; /* load army on ship */
+		if (!LINKS(obj)->ship) set_func (obj, 1); /* load army on ship */
 		return;
 	}
-	if (obj->ship) /* is army on a transport? */
+	if (LINKS(obj)->ship) /* is army on a transport? */
 		new_loc = find_attack (obj->loc, army_attack, "+*");
 	else new_loc = find_attack (obj->loc, army_attack, ".+*");
 		
 	if (new_loc != obj->loc) { /* something to attack? */
 		attack (obj, new_loc); /* attack it */
-		if (map[new_loc].contents == '.' /* moved to ocean? */
+		if (game->map[new_loc].contents == '.' /* moved to ocean? */
 		  && obj->hits > 0) { /* object still alive? */
 			kill_obj (obj, new_loc);
 			scan (user_map, new_loc); /* rescan for user */
 		}
 		return;
 	}
-	if (obj->ship) {
-		if (obj->ship->func == 0) {
+	if (LINKS(obj)->ship) {
+		if (OBJ(LINKS(obj)->ship)->func == 0) {
 			if (!load_army (obj)) ABORT; /* load army on best ship */
 			return; /* armies stay on a loading ship */
 		}
 		make_unload_map (amap, comp_map);
-		new_loc = vmap_find_wlobj (path_map, amap, obj->loc, &tt_unload);
-		move_objective (obj, path_map, new_loc, " ");
+		new_loc = vmap_find_wlobj (game->path_map, amap, obj->loc, &tt_unload);
+		move_objective (obj, game->path_map, new_loc, " ");
 		return;
 	}
 
-	new_loc = vmap_find_lobj (path_map, comp_map, obj->loc, &army_fight);
+	new_loc = vmap_find_lobj (game->path_map, comp_map, obj->loc, &army_fight);
 	
 	if (new_loc != obj->loc) { /* something interesting on land? */
 		switch (comp_map[new_loc].contents) {
@@ -557,7 +624,7 @@ piece_info_t *obj;
 		default:
 			ABORT;
 		}
-		cross_cost = path_map[new_loc].cost * 2 - cross_cost;
+		cross_cost = game->path_map[new_loc].cost * 2 - cross_cost;
 	}
 	else cross_cost = INFINITY;
 	
@@ -572,7 +639,7 @@ piece_info_t *obj;
 		}
 	}
 
-	move_objective (obj, path_map, new_loc, " ");
+	move_objective (obj, game->path_map, new_loc, " ");
 }
 
 /*
@@ -586,7 +653,7 @@ view_map_t *xmap;
 	long i;
 
 	for (i = 0; i < MAP_SIZE; i++)
-	if (map[i].on_board && xmap[i].contents == ' ')
+	if (ON_BOARD (i) && xmap[i].contents == ' ')
 		xmap[i].contents = emap[i].contents;
 }
 
@@ -607,16 +674,16 @@ view_map_t *vmap;
 	(void) memcpy (xmap, vmap, sizeof (view_map_t) * MAP_SIZE);
 
 	/* mark loading transports or cities building transports */
-	for (p = comp_obj[TRANSPORT]; p; p = p->piece_link.next)
+	for (p = OBJ(comp_obj[TRANSPORT]); p; p = OBJ(LINKS(p)->piece_link.next))
 	if (p->func == 0) /* loading tt? */
 	xmap[p->loc].contents = '$';
 	
 	for (i = 0; i < NUM_CITY; i++)
-	if (city[i].owner == COMP && city[i].prod == TRANSPORT) {
-		if (nearby_load (obj, city[i].loc))
-			xmap[city[i].loc].contents = 'x'; /* army is nearby so it can load */
-		else if (nearby_count (city[i].loc) < piece_attr[TRANSPORT].capacity)
-			xmap[city[i].loc].contents = 'x'; /* city needs armies */
+	if (game->city[i].owner == COMP && game->city[i].prod == TRANSPORT) {
+		if (nearby_load (obj, game->city[i].loc))
+			xmap[game->city[i].loc].contents = 'x'; /* army is nearby so it can load */
+		else if (nearby_count (game->city[i].loc) < piece_attr[TRANSPORT].capacity)
+			xmap[game->city[i].loc].contents = 'x'; /* city needs armies */
 	}
 	
 	if (print_vmap == 'A') print_xzoom (xmap);
@@ -639,10 +706,10 @@ nearby_count (loc)
 long loc;
 {
 	piece_info_t *obj;
-	int count;
+	int count, i;
 
 	count = 0;
-	for (obj = comp_obj[ARMY]; obj; obj = obj->piece_link.next) {
+	FOR_PIECES (COMP, ARMY, obj, i) {
 		if (nearby_load (obj, loc)) count += 1;
 	}
 	return count;
@@ -656,11 +723,12 @@ view_map_t *xmap;
 view_map_t *vmap;
 {
 	piece_info_t *p;
+	int i;
 	
 	(void) memcpy (xmap, vmap, sizeof (view_map_t) * MAP_SIZE);
 
 	/* mark loading armies */
-	for (p = comp_obj[ARMY]; p; p = p->piece_link.next)
+	FOR_PIECES (COMP, ARMY, p, i)
 	if (p->func == 1) /* loading army? */
 	xmap[p->loc].contents = '$';
 	
@@ -694,8 +762,8 @@ b)  if enemy_cities == 1 && total_cities == 1, set number to 2.
 c)  Any other attackable city is marked with a '0'.
 */
 
-static int owncont_map[MAP_SIZE];
-static int tcont_map[MAP_SIZE];
+#define owncont_map (game->owncont_map)
+#define tcont_map (game->tcont_map)
 
 void
 make_unload_map (xmap, vmap)
@@ -704,6 +772,9 @@ view_map_t *vmap;
 {
 	long i;
 	scan_counts_t counts;
+	long start;
+
+	start = phase_begin ();
 
 	(void) memcpy (xmap, vmap, sizeof (view_map_t) * MAP_SIZE);
 	unmark_explore_locs (xmap);
@@ -712,8 +783,8 @@ view_map_t *vmap;
 		owncont_map[i] = 0; /* nothing marked */
 
 	for (i = 0; i < NUM_CITY; i++)
-	if (city[i].owner == COMP)
-	vmap_mark_up_cont (owncont_map, xmap, city[i].loc, '.');
+	if (game->city[i].owner == COMP)
+	vmap_mark_up_cont (owncont_map, xmap, game->city[i].loc, '.');
 
 	for (i = 0; i < MAP_SIZE; i++)
 	if (strchr ("O*", vmap[i].contents)) {
@@ -741,6 +812,7 @@ view_map_t *vmap;
 		else xmap[i].contents = '0';
 	}
 	if (print_vmap == 'U') print_xzoom (xmap);
+	phase_end (PH_UNLOAD_MAP, start);
 }
 
 /*
@@ -756,7 +828,7 @@ path_map_t *pmap;
 long dest;
 {
 	if (!load_army (obj)) {
-		obj->func = 1; /* loading */
+		set_func (obj, 1); /* loading */
 		move_objective (obj, pmap, dest, "t.");
 	}
 }
@@ -774,10 +846,12 @@ long loc;
 {
 	piece_info_t *p;
 
-	for (p = map[loc].objp; p != NULL; p = p->loc_link.next)
-	if (p->type == TRANSPORT && obj_capacity (p) > p->count) {
+	if (!(occupancy[loc].types & (1 << TRANSPORT))) return best;
+
+	for (p = OBJ(game->map[loc].objp); p != NULL; p = OBJ(LINKS(p)->loc_link.next))
+	if (p->type == TRANSPORT && obj_capacity (p) > LINKS(p)->count) {
 		if (!best) best = p;
-		else if (p->count >= best->count) best = p;
+		else if (LINKS(p)->count >= LINKS(best)->count) best = p;
 	}
 	return best;
 }
@@ -794,11 +868,11 @@ piece_info_t *obj;
 	int i;
 	long x_loc;
 
-	p = find_best_tt (obj->ship, obj->loc); /* look here first */
+	p = find_best_tt (OBJ(LINKS(obj)->ship), obj->loc); /* look here first */
 
 	for (i = 0; i < 8; i++) { /* try surrounding squares */
 		x_loc = obj->loc + dir_offset[i];
-		if (map[x_loc].on_board)
+		if (ON_BOARD (x_loc))
 			p = find_best_tt (p, x_loc);
 
 	}
@@ -809,7 +883,7 @@ piece_info_t *obj;
 	}
 	else move_obj (obj, p->loc); /* move to square with ship */
 
-	if (p->ship != obj->ship) { /* reload army to new ship */
+	if (LINKS(p)->ship != LINKS(obj)->ship) { /* reload army to new ship */
 		disembark (obj);
 		embark (p, obj);
 	}
@@ -832,7 +906,7 @@ char *terrain;
 
 	for (i = 0; i < 8; i++) {
 		new_loc = loc + dir_offset[i];
-		if (map[new_loc].on_board
+		if (ON_BOARD (new_loc)
 		 && strchr (terrain, vmap[new_loc].contents))
 			return (new_loc);
 	}
@@ -854,16 +928,17 @@ char *obj_list;
 char *terrain;
 {
 	long new_loc, best_loc;
-	int i, best_val;
+	int i, best_val, bits;
 	char *p;
 
 	best_loc = loc; /* nothing found yet */
 	best_val = INFINITY;
+	bits = terrain_class (terrain);
 	for (i = 0; i < 8; i++) {
 		new_loc = loc + dir_offset[i];
 
-		if (map[new_loc].on_board /* can we move here? */
-		    && strchr (terrain, map[new_loc].contents)) {
+		if (ON_BOARD (new_loc) /* can we move here? */
+		    && (cell_class[new_loc] & bits)) {
 			p = strchr (obj_list, comp_map[new_loc].contents);
 			if (p != NULL && p - obj_list < best_val) {
 				best_val = p - obj_list;
@@ -895,8 +970,8 @@ piece_info_t *obj;
 	long new_loc;
 
 	/* empty transports can attack */
-	if (obj->count == 0) { /* empty? */
-		obj->func = 0; /* transport is loading */
+	if (LINKS(obj)->count == 0) { /* empty? */
+		set_func (obj, 0); /* transport is loading */
 		new_loc = find_attack (obj->loc, tt_attack, ".");
 		if (new_loc != obj->loc) { /* something to attack? */
 			attack (obj, new_loc); /* attack it */
@@ -904,26 +979,26 @@ piece_info_t *obj;
 		}
 	}
 
-	if (obj->count == obj_capacity (obj)) /* full? */
-		obj->func = 1; /* unloading */
+	if (LINKS(obj)->count == obj_capacity (obj)) /* full? */
+		set_func (obj, 1); /* unloading */
 
 	if (obj->func == 0) { /* loading? */
 		make_tt_load_map (amap, comp_map);
-		new_loc = vmap_find_wlobj (path_map, amap, obj->loc, &tt_load);
+		new_loc = vmap_find_wlobj (game->path_map, amap, obj->loc, &tt_load);
 		
 		if (new_loc == obj->loc) { /* nothing to load? */
 			(void) memcpy (amap, comp_map, MAP_SIZE * sizeof (view_map_t));
 			unmark_explore_locs (amap);
 			if (print_vmap == 'S') print_xzoom (amap);
-			new_loc = vmap_find_wobj (path_map, amap, obj->loc,&tt_explore);
+			new_loc = vmap_find_wobj (game->path_map, amap, obj->loc,&tt_explore);
 		}
 		
-		move_objective (obj, path_map, new_loc, "a ");
+		move_objective (obj, game->path_map, new_loc, "a ");
 	}
 	else {
 		make_unload_map (amap, comp_map);
-		new_loc = vmap_find_wlobj (path_map, amap, obj->loc, &tt_unload);
-		move_objective (obj, path_map, new_loc, " ");
+		new_loc = vmap_find_wlobj (game->path_map, amap, obj->loc, &tt_unload);
+		move_objective (obj, game->path_map, new_loc, " ");
 	}
 }
 
@@ -953,16 +1028,16 @@ piece_info_t *obj;
 	/* return to base if low on fuel */
 	if (obj->range <= find_nearest_city (obj->loc, COMP, &new_loc) + 2) {
 		if (new_loc != obj->loc)
-			new_loc = vmap_find_dest (path_map, comp_map, obj->loc,
+			new_loc = vmap_find_dest (game->path_map, comp_map, obj->loc,
 						  new_loc, COMP, T_AIR);
 	}
 	else new_loc = obj->loc;
 	
 	if (new_loc == obj->loc) { /* no nearby city? */
-		new_loc = vmap_find_aobj (path_map, comp_map, obj->loc,
+		new_loc = vmap_find_aobj (game->path_map, comp_map, obj->loc,
 					       &fighter_fight);
 	}
-	move_objective (obj, path_map, new_loc, " ");
+	move_objective (obj, game->path_map, new_loc, " ");
 }
 
 /*
@@ -984,7 +1059,7 @@ piece_info_t *obj;
 			obj->moved = piece_attr[obj->type].speed;
 			return;
 		}
-		new_loc = vmap_find_wobj (path_map, comp_map, obj->loc, &ship_repair);
+		new_loc = vmap_find_wobj (game->path_map, comp_map, obj->loc, &ship_repair);
 		adj_list = ".";
 
 	}
@@ -999,11 +1074,11 @@ piece_info_t *obj;
 		unmark_explore_locs (amap);
 		if (print_vmap == 'S') print_xzoom (amap);
 		
-		new_loc = vmap_find_wobj (path_map, amap, obj->loc,&ship_fight);
+		new_loc = vmap_find_wobj (game->path_map, amap, obj->loc,&ship_fight);
 		adj_list = ship_fight.objectives;
 	}
 
-	move_objective (obj, path_map, new_loc, adj_list);
+	move_objective (obj, game->path_map, new_loc, adj_list);
 }
 
 /*
@@ -1053,7 +1128,7 @@ char *adj_list;
 				 terrain, adj_list);
 	
 	if (new_loc == obj->loc /* path is blocked? */
-	    && (obj->type != ARMY || !obj->ship)) { /* don't unblock armies on a ship */
+	    && (obj->type != ARMY || !LINKS(obj)->ship)) { /* don't unblock armies on a ship */
 		vmap_mark_near_path (pathmap, obj->loc);
 		reuse = 0;
 		new_loc = vmap_find_dir (pathmap, comp_map, obj->loc,
@@ -1061,7 +1136,7 @@ char *adj_list;
 	}
 	
 	/* encourage army to leave city */
-	if (new_loc == obj->loc && map[obj->loc].cityp != NULL
+	if (new_loc == obj->loc && game->map[obj->loc].cityp
 				&& obj->type == ARMY) {
 		new_loc = move_away (comp_map, obj->loc, "+");
 		reuse = 0;
@@ -1069,7 +1144,7 @@ char *adj_list;
 	if (new_loc == obj->loc) {
 		obj->moved = piece_attr[obj->type].speed;
 		
-		if (obj->type == ARMY && obj->ship) ;
+		if (obj->type == ARMY && LINKS(obj)->ship) ;
 		else pdebug ("Cannot move %d at %d toward objective; func=%d\n", obj->type, obj->loc, obj->func,0,0,0,0,0);
 	}
 	else move_obj (obj, new_loc);
@@ -1087,12 +1162,12 @@ char *adj_list;
 			break;
 		case ARMY:
 			attack_list = army_attack;
-			if (obj->ship) terrain = "+*";
+			if (LINKS(obj)->ship) terrain = "+*";
 			else terrain = "+.*";
 			break;
 		case TRANSPORT:
 			terrain = ".*";
-			if (obj->cargo) attack_list = tt_attack;
+			if (LINKS(obj)->cargo) attack_list = tt_attack;
 			else attack_list = "*O"; /* causes tt to wake up */
 			break;
 		default:
@@ -1129,26 +1204,25 @@ check_endgame () { /* see if game is over */
 	piece_info_t *p;
 	int i;
 	
-	date += 1; /* one more turn has passed */
-	if (win != 0) return; /* we already know game is over */
+	game->date += 1; /* one more turn has passed */
+	if (game->win != 0) return; /* we already know game is over */
 
 	nuser_city = 0; /* nothing counted yet */
 	ncomp_city = 0;
-	nuser_army = 0;
-	ncomp_army = 0;
+	nuser_army = COUNT_PIECES (USER, ARMY);
+	ncomp_army = COUNT_PIECES (COMP, ARMY);
 	
 	for (i = 0; i < NUM_CITY; i++) {
-		if (city[i].owner == USER) nuser_city++;
-		else if (city[i].owner == COMP) ncomp_city++;
+		if (game->city[i].owner == USER) nuser_city++;
+		else if (game->city[i].owner == COMP) ncomp_city++;
 	}
-	
-	for (p = user_obj[ARMY]; p != NULL; p = p->piece_link.next)
-		nuser_army++;
-	
-	for (p = comp_obj[ARMY]; p != NULL; p = p->piece_link.next)
-		ncomp_army++;
 		
 	if (ncomp_city < nuser_city/3 && ncomp_army < nuser_army/3) {
+		if (batch_turns) { /* nobody to ask; just resign */
+			resigned = TRUE;
+			game->win = 2;
+			return;
+		}
 		clear_screen ();
 		prompt ("The computer acknowledges defeat. Do",0,0,0,0,0,0,0,0);
 		ksend ("The computer acknowledges defeat.",0,0,0,0,0,0,0,0);
@@ -1159,7 +1233,7 @@ check_endgame () { /* see if game is over */
 		(void) addstr ("\nreceiving battle information. You can display what");
 		(void) addstr ("\nthey've learned with the ''E'' command.");
 		resigned = TRUE;
-		win = 2;
+		game->win = 2;
 		automove = FALSE;
 	}
 	else if (ncomp_city == 0 && ncomp_army == 0) {
@@ -1168,7 +1242,7 @@ check_endgame () { /* see if game is over */
 		(void) addstr ("You are free to rape the empire as you wish.\n");
 	    	(void) addstr ("There may be, however, remnants of the enemy fleet\n");
 	    	(void) addstr ("to be routed out and destroyed.\n");
-		win = 1;
+		game->win = 1;
 		automove = FALSE;
 	}
 	else if (nuser_city == 0 && nuser_army == 0) {
@@ -1177,7 +1251,7 @@ check_endgame () { /* see if game is over */
 	    	(void) addstr ("defeating the rampaging enemy fascists! The\n");
 	    	(void) addstr ("empire is lost. If you have any ships left, you\n");
 	    	(void) addstr ("may attempt to harass enemy shipping.");
-		win = 1;
+		game->win = 1;
 		automove = FALSE;
 	}
 }
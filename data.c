@@ -71,17 +71,6 @@ piece_attr_t piece_attr[] = {
 		".+", 50, 0, 1, 10, 0, 500}
 };
 
-/* Direction offsets. */
-
-int dir_offset [] = {-MAP_WIDTH, /* north */
-		     -MAP_WIDTH+1, /* northeast */
-		     1, /* east */
-		     MAP_WIDTH+1, /* southeast */
-		     MAP_WIDTH, /* south */
-		     MAP_WIDTH-1, /* southwest */
-		     -1, /* west */
-		     -MAP_WIDTH-1}; /* northwest */
-
 /* Names of movement functions. */
 
 char *func_name[] = {"none", "random", "sentry", "fill", "land",
@@ -96,6 +85,26 @@ int move_order[] = {SATELLITE, TRANSPORT, CARRIER, BATTLESHIP,
 /* types of pieces, in declared order */
 char type_chars[] = "AFPDSTCBZ";
 
+/* number of the lowest bit set in a byte, or 8 for none; see FOR_ADJ_ON */
+uchar low_bit[256] = {
+	8, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	6, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	7, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	6, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0,
+	4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0
+};
+
 /* Lists of attackable objects if object is adjacent to moving piece. */
 
 char tt_attack[] = "T";
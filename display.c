@@ -36,6 +36,8 @@ static int save_cursor; /* currently displayed cursor position */
 static int change_ok = TRUE; /* true if new sector may be displayed */
 
 static void show_loc(view_map_t vmap[],long loc);
+static void print_area(int whose,view_map_t vmap[],int sector,
+	int first_row,int first_col,int last_row,int last_col);
 static disp_square(view_map_t *vp);
 
 #ifdef A_COLOR
@@ -99,6 +101,9 @@ the requested location.
 
 We redisplay the sector only if we either have been requested to
 redisplay the sector, or if the location is not on the screen.
+
+Sectors grow with the map, so on a big map a sector may not fit on
+the screen.  Then we center the screen on the location instead.
 */
 
 void
@@ -108,10 +113,19 @@ view_map_t vmap[];
 long loc; /* location to display */
 {
 	void print_sector();
+	int r, c;
 	
-	if (change_ok || whose != whose_map || !on_screen (loc))
-		print_sector (whose, vmap, loc_sector (loc));
-		
+	if (rolling_out) return;
+	if (change_ok || whose != whose_map || !on_screen (loc)) {
+		if (ROWS_PER_SECTOR <= lines - NUMTOPS - 1
+		 && COLS_PER_SECTOR <= cols - NUMSIDES)
+			print_sector (whose, vmap, loc_sector (loc));
+		else {
+			r = loc_row (loc);
+			c = loc_col (loc);
+			print_area (whose, vmap, loc_sector (loc), r, c, r, c);
+		}
+	}
 	show_loc (vmap, loc);
 }
 
@@ -125,7 +139,7 @@ int whose; /* whose map to display */
 view_map_t vmap[];
 long loc; /* location to display */
 {
-	if (whose == whose_map && on_screen (loc))
+	if (!rolling_out && whose == whose_map && on_screen (loc))
 		show_loc (vmap, loc);
 }
 
@@ -172,10 +186,34 @@ print_sector (whose, vmap, sector)
 char whose; /* USER or COMP */
 view_map_t vmap[]; /* map to display */
 int sector; /* sector to display */
+{
+	int first_row, first_col;
+
+	/* compute row and column edges of sector */
+	first_row = sector_row (sector) * ROWS_PER_SECTOR;
+	first_col = sector_col (sector) * COLS_PER_SECTOR;
+
+	print_area (whose, vmap, sector, first_row, first_col,
+		    first_row + ROWS_PER_SECTOR - 1,
+		    first_col + COLS_PER_SECTOR - 1);
+}
+
+/*
+Print the part of the map around the rows and columns given, which
+lie in the given sector.  The area is centered on the screen as well
+as the edges of the map allow.
+*/
+
+static void
+print_area (whose, vmap, sector, first_row, first_col, last_row, last_col)
+int whose; /* USER or COMP */
+view_map_t vmap[]; /* map to display */
+int sector; /* sector the area is in */
+int first_row, first_col; /* upper-left corner of area */
+int last_row, last_col; /* lower-right corner of area */
 {
 	void display_screen();
 
-	int first_row, first_col, last_row, last_col;
 	int display_rows, display_cols;
 	int r, c;
 
@@ -185,12 +223,6 @@ int sector; /* sector to display */
 	display_rows = lines - NUMTOPS - 1; /* num lines to display */
 	display_cols = cols - NUMSIDES;
 
-	/* compute row and column edges of sector */
-	first_row = sector_row (sector) * ROWS_PER_SECTOR;
-	first_col = sector_col (sector) * COLS_PER_SECTOR;
-	last_row = first_row + ROWS_PER_SECTOR - 1;
-	last_col = first_col + COLS_PER_SECTOR - 1;
-
 	if (!(whose == whose_map /* correct map is on screen? */
 	   && ref_row <= first_row /* top row on screen? */
 	   && ref_col <= first_col /* first col on screen? */
@@ -201,8 +233,8 @@ int sector; /* sector to display */
 	/* figure out first row and col to print; subtract half
 	   the extra lines from the first line */
 
-	ref_row = first_row - (display_rows - ROWS_PER_SECTOR) / 2;
-	ref_col = first_col - (display_cols - COLS_PER_SECTOR) / 2;
+	ref_row = first_row - (display_rows - (last_row - first_row + 1)) / 2;
+	ref_col = first_col - (display_cols - (last_col - first_col + 1)) / 2;
 
 	/* try not to go past bottom of map */
 	if (ref_row + display_rows - 1 > MAP_HEIGHT - 1)
@@ -232,7 +264,7 @@ int sector; /* sector to display */
 		else pos_str (r-ref_row+NUMTOPS, cols-NUMSIDES+1, "  ",0,0,0,0,0,0,0,0);
 	}
 	/* print round number */
-	(void) sprintf (jnkbuf, "Sector %d Round %d", sector, date);
+	(void) sprintf (jnkbuf, "Sector %d Round %d", sector, game->date);
 	for (r = 0; jnkbuf[r] != '\0'; r++) {
 		if (r+NUMTOPS >= MAP_HEIGHT) break;
 		(void) move (r+NUMTOPS, cols-NUMSIDES+4);
@@ -323,7 +355,7 @@ int offset; /* offset to add to cursor */
 	int r, c;
  
 	t = *cursor + offset; /* proposed location */
-	if (!map[t].on_board) return (FALSE); /* trying to move off map */
+	if (!ON_BOARD (t)) return (FALSE); /* trying to move off map */
 	if (!on_screen (t)) return (FALSE); /* loc is off screen */
 	
 	*cursor = t; /* update cursor position */
@@ -394,7 +426,7 @@ view_map_t *vmap;
 	for (c = 0; c < MAP_WIDTH; c += col_inc)
 	print_zoom_cell (vmap, r, c, row_inc, col_inc);
 
-	pos_str (0, 0, "Round #%d", date,0,0,0,0,0,0,0);
+	pos_str (0, 0, "Round #%d", game->date,0,0,0,0,0,0,0);
 	
 	(void) refresh ();
 }
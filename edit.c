@@ -184,7 +184,7 @@ long func;
 	piece_info_t *obj;
 	obj = find_obj_at_loc (loc);
 	if (obj != NULL && obj->owner == USER) {
-		obj->func = func;
+		set_func (obj, func);
 		return;
 	}
 	huh (); /* no object here */
@@ -389,8 +389,8 @@ long loc;
 		for (i = 0; i < NUM_OBJECTS; i++)
 			cityp->func[i] = NOFUNC;
 	}
-	for (obj = map[loc].objp; obj != NULL; obj = obj->loc_link.next)
-		obj->func = NOFUNC;
+	for (obj = OBJ(game->map[loc].objp); obj != NULL; obj = OBJ(LINKS(obj)->loc_link.next))
+		set_func (obj, NOFUNC);
 }
 
 void
@@ -526,10 +526,10 @@ long edit_cursor;
 	ab = user_map[edit_cursor].contents;
 
 	if (ab == 'O') e_city_info (edit_cursor);
-	else if (ab == 'X' && debug) e_city_info (edit_cursor);
+	else if (ab == 'X' && game->debug) e_city_info (edit_cursor);
 	else if ((ab >= 'A') && (ab <= 'T'))
 		e_piece_info (edit_cursor, ab);
-	else if ((ab >= 'a') && (ab <= 't') && (debug))
+	else if ((ab >= 'a') && (ab <= 't') && (game->debug))
 		e_piece_info (edit_cursor, ab);
 	else huh ();
 }
@@ -574,13 +574,13 @@ long edit_cursor;
 	error (0,0,0,0,0,0,0,0,0); /* clear line */
 
 	f = 0; /* no fighters counted yet */
-	for (obj = map[edit_cursor].objp; obj != NULL;
-		obj = obj->loc_link.next)
+	for (obj = OBJ(game->map[edit_cursor].objp); obj != NULL;
+		obj = OBJ(LINKS(obj)->loc_link.next))
 			if (obj->type == FIGHTER) f++;
 
 	s = 0; /* no ships counted yet */
-	for (obj = map[edit_cursor].objp; obj != NULL;
-		obj = obj->loc_link.next)
+	for (obj = OBJ(game->map[edit_cursor].objp); obj != NULL;
+		obj = OBJ(LINKS(obj)->loc_link.next))
 			if (obj->type >= DESTROYER) s++;
 
 	if (f == 1 && s == 1) 
@@ -611,7 +611,7 @@ long edit_cursor;
 		"City at location %d will complete %s on round %d",
 		cityp->loc,
 		piece_attr[cityp->prod].article,
-		date + piece_attr[cityp->prod].build_time - cityp->work);
+		game->date + piece_attr[cityp->prod].build_time - cityp->work);
 
 	info (junk_buf2, jnkbuf, func_buf);
 }
@@ -17,7 +17,7 @@ parser, and the simple commands.
 #include "empire.h"
 #include "extern.h"
 
-void c_examine(), c_movie();
+void c_examine(), c_movie(), batch_game();
 
 void
 empire () {
@@ -27,6 +27,10 @@ empire () {
 	char order;
 	int turn = 0;
 
+	if (batch_turns) { /* no display; just let the computer play */
+		batch_game ();
+		return;
+	}
 	ttinit (); /* init tty */
 	rndini (); /* init random number generator */
 
@@ -38,6 +42,7 @@ empire () {
 
 	if (!restore_game ()) /* try to restore previous game */
 		init_game (); /* otherwise init a new game */
+	fit_screen (); /* the saved map may not be the size we asked for */
 
 	/* Command loop starts here. */
 
@@ -86,7 +91,7 @@ char orders;
 		break;
 	
 	case 'D': /* display round number */
-		error ("Round #%d", date,0,0,0,0,0,0,0);
+		error ("Round #%d", game->date,0,0,0,0,0,0,0);
 		break;
 
 	case 'E': /* examine enemy map */
@@ -136,6 +141,7 @@ char orders;
 	case 'R': /* restore game */
 		clear_screen ();
 		e = restore_game ();
+		fit_screen ();
 		break;
 
 	case 'S': /* save game */
@@ -149,7 +155,7 @@ char orders;
 		break;
 
 	case 'W': /* watch movie */
-		if (resigned || debug) replay_movie ();
+		if (resigned || game->debug) replay_movie ();
 		else error ("You cannot watch movie until computer resigns.",0,0,0,0,0,0,0,0);
 		break;
 	
@@ -165,13 +171,13 @@ char orders;
 
 	case '+': /* change debug state */
 		e = get_chx();
-		if ( e  ==  '+' ) debug = TRUE;
-		else if ( e  ==  '-' ) debug = FALSE;
+		if ( e  ==  '+' ) game->debug = TRUE;
+		else if ( e  ==  '-' ) game->debug = FALSE;
 		else huh ();
 		break;
 
 	default:
-		if (debug) c_debug (orders); /* debug */
+		if (game->debug) c_debug (orders); /* debug */
 		else huh (); /* illegal command */
 		break;
 	}
@@ -179,34 +185,27 @@ char orders;
 }
 
 /*
-Give an unowned city (if any) to the computer.  We make
-a list of unowned cities, choose one at random, and mark
-it as the computers.
+Give an unowned city (if any) to the computer.  We choose one of
+the unowned cities at random, and mark it as the computers.
 */
 
 void
 c_give () {
-	int unowned[NUM_CITY];
 	long i, count;
 
-	count = 0; /* nothing in list yet */
-	for (i = 0; i < NUM_CITY; i++) {
-		if (city[i].owner == UNOWNED) {
-			unowned[count] = i; /* remember this city */
-			count += 1;
-		}
-	}
+	count = owned_cities[UNOWNED];
 	if (count == 0) {
 		error ("There are no unowned cities.",0,0,0,0,0,0,0,0);
 		ksend ("There are no unowned cities.",0,0,0,0,0,0,0,0);
 		return;
 	}
-	i = irand (count);
-	i = unowned[i]; /* get city index */
-	city[i].owner = COMP;
-	city[i].prod = NOPIECE;
-	city[i].work = 0;
-	scan (comp_map, city[i].loc);
+	count = irand (count); /* number of unowned cities to pass over */
+	for (i = 0; game->city[i].owner != UNOWNED || count-- > 0; i++);
+
+	set_city_owner (&game->city[i], COMP);
+	game->city[i].prod = NOPIECE;
+	game->city[i].work = 0;
+	scan (comp_map, game->city[i].loc);
 }
 
 /*
@@ -242,10 +241,70 @@ char order;
 		print_vmap = get_chx();
 		break;
 
+	case '*': /* change stack measuring state or show memory use */
+		e = get_chx();
+		if ( e  ==  '+' ) stack_enable (TRUE);
+		else if ( e  ==  '-' ) stack_enable (FALSE);
+		else if ( e  ==  '=' ) mem_report (FALSE);
+		else huh ();
+		break;
+
+	case '!': /* change timing state or show timings */
+		e = get_chx();
+		if ( e  ==  '+' ) stats_enable (TRUE);
+		else if ( e  ==  '-' ) stats_enable (FALSE);
+		else if ( e  ==  '=' ) stats_display ();
+		else if ( e  ==  '#' ) stats_search_display ();
+		else huh ();
+		break;
+
 	default: huh (); break;
 	}
 }
 
+/*
+Play a game without a display.  There is nobody at the keyboard, so
+the user's pieces never move, just as in the debugging movie.  We
+play until the game is over or 'batch_turns' turns have passed, then
+report the outcome on the standard output.  If 'batch_hash' is set,
+we also print the hash of the game after each turn, so that runs
+with the same seed can be compared.
+*/
+
+void
+batch_game () {
+	int nuser, ncomp;
+	char *winner;
+
+	if (batch_seed) rndset (batch_seed);
+	else rndini (); /* init random number generator */
+	init_game ();
+	if (batch_memory) stack_enable (TRUE);
+
+	while (game->win == 0 && game->date < batch_turns) {
+		comp_move (1);
+		if (batch_hash)
+			(void) printf ("turn %ld hash %016llx\n", game->date, state_hash ());
+	}
+
+	nuser = owned_cities[USER];
+	ncomp = owned_cities[COMP];
+	if (game->win == 0) winner = "none";
+	else if (ncomp > nuser) winner = "computer";
+	else winner = "user";
+
+	(void) printf ("turns %ld winner %s user cities %d computer cities %d\n",
+		game->date, winner, nuser, ncomp);
+	if (check_errors)
+		(void) printf ("consistency problems %ld; see empcheck.dat\n",
+			check_errors);
+	if (batch_memory) {
+		(void) printf ("\n");
+		mem_report (TRUE);
+	}
+	trace_flush ();
+}
+
 /*
 The quit command.  Make sure the user really wants to quit.
 */
@@ -281,7 +340,7 @@ void
 c_map () {
 	FILE *f;
 	int i, j;
-	char line[MAP_HEIGHT+2];
+	char *line;
 
 	prompt ("Filename? ",0,0,0,0,0,0,0,0);
 	get_str (jnkbuf, STRSIZE);
@@ -291,6 +350,7 @@ c_map () {
 		error ("I can't open that file.",0,0,0,0,0,0,0,0);
 		return;
 	}
+	line = game->mapbuf; /* room for a column and a newline */
 	for (i = 0; i < MAP_WIDTH; i++) { /* for each column */
 		for (j = MAP_HEIGHT-1; j >= 0; j--) { /* for each row */
                         line[MAP_HEIGHT-1-j] = user_map[row_col_loc(j,i)].contents;
@@ -331,7 +391,7 @@ c_movie () {
 		print_zoom (comp_map);
 		save_game ();
 #ifdef PROFILE
-		if (date == 125) empend();
+		if (game->date == 125) empend();
 #endif
 	}
 }
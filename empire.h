@@ -55,10 +55,23 @@ typedef unsigned char uchar;
 
 /* Information we maintain about cities. */
 
-#define NUM_CITY 70
+#define DEF_NUM_CITY 70 /* number of cities unless we are told otherwise */
+#define MIN_NUM_CITY 10 /* limits on the number of cities */
+#define MAX_NUM_CITY 5000
+#define CELLS_PER_CITY 40 /* a map needs this many cells for each city */
+
 #define UNOWNED 0
 #define USER 1
 #define COMP 2
+#define NUM_OWNERS 3
+
+/*
+For finding the nearest city, the map is cut into squares CITY_GRID
+cells on a side, and each square keeps a list of the cities in it for
+each owner.  See find_nearest_city.
+*/
+
+#define CITY_GRID 16
 
 /* Piece types. */
 #define ARMY 0
@@ -72,8 +85,16 @@ typedef unsigned char uchar;
 #define SATELLITE 8
 #define NUM_OBJECTS 9 /* number of defined objects */
 #define NOPIECE ((char)255) /* a 'null' piece */
+#define SAT_RADIUS 3 /* how far a satellite sees; see scan_radius */
+
+/*
+Pieces are kept in a pool that grows a chunk at a time as they are
+built (see object.c).  A chunk never moves once it is allocated.
+*/
 
-#define LIST_SIZE 5000 /* max number of pieces on board */
+#define POOL_SHIFT 8
+#define POOL_CHUNK (1 << POOL_SHIFT) /* pieces per chunk */
+#define POOL_MASK (POOL_CHUNK - 1)
 
 typedef struct city_info {
 	long loc; /* location of city */
@@ -119,57 +140,121 @@ Macro to convert a movement function into a direction.
 
 /*
 Information we maintain about each piece.
+
+Pieces, lists and map cells refer to pieces and cities by number
+rather than by pointer, so that a game can be copied, saved and
+restored without fixing anything up.  A reference is one more than
+the index of the piece in the object pool (or the city in 'city');
+zero means none.  OBJ and CITY turn a reference into a pointer, and
+OBJ_REF and CITY_REF turn a pointer back into a reference.  Each
+piece keeps its own reference, since the pool is not one array.
+
+What we know about a piece is split in two.  The piece_info_t holds
+what is looked at on every move and is kept small so that many pieces
+share a cache line.  The lists the piece is on and what it carries are
+kept in a piece_links_t in a parallel pool; LINKS finds the links of a
+piece and REF_LINKS the links of a reference.
 */
 
-typedef struct { /* ptrs for doubly linked list */
-	struct piece_info *next; /* pointer to next in list */
-	struct piece_info *prev; /* pointer to prev in list */
+#define POOL_OBJ(i) (&obj_chunk[(i) >> POOL_SHIFT][(i) & POOL_MASK])
+#define OBJ(r) ((r) ? POOL_OBJ((r)-1) : (piece_info_t *)NULL)
+#define OBJ_REF(p) ((p) ? (p)->ref : 0)
+#define REF_LINKS(r) \
+	(&link_chunk[((r)-1) >> POOL_SHIFT][((r)-1) & POOL_MASK])
+#define LINKS(p) REF_LINKS((p)->ref)
+#define CITY(r) ((r) ? &game->city[(r)-1] : (city_info_t *)NULL)
+#define CITY_REF(p) ((p) ? (int)((p) - game->city) + 1 : 0)
+
+typedef struct { /* refs for doubly linked list */
+	int next; /* next in list */
+	int prev; /* prev in list */
 } link_t;
 
 typedef struct piece_info {
+	int loc; /* location of piece */
+	int func; /* programmed type of movement */
+	int moved; /* moves made */
+	int ref; /* reference to this piece */
+	short hits; /* hits left */
+	short range; /* current range (if applicable) */
+	uchar owner; /* owner of piece */
+	uchar type; /* type of piece */
+} piece_info_t;
+
+typedef struct piece_links {
 	link_t piece_link; /* linked list of pieces of this type */
 	link_t loc_link; /* linked list of pieces at a location */
 	link_t cargo_link; /* linked list of cargo pieces */
-	int owner; /* owner of piece */
-	int type; /* type of piece */
-	long loc; /* location of piece */
-	long func; /* programmed type of movement */
-	short hits; /* hits left */
-	int moved; /* moves made */
-	struct piece_info *ship; /* pointer to containing ship */
-	struct piece_info *cargo; /* pointer to cargo list */
+	int ship; /* containing ship */
+	int cargo; /* cargo list */
 	short count; /* count of items on board */
-	short range; /* current range (if applicable) */
-} piece_info_t;
+} piece_links_t;
 
 /*
 Macros to link and unlink an object from a doubly linked list.
 */
 
 #define LINK(head,obj,list) { \
-	obj->list.prev = NULL; \
-	obj->list.next = head; \
-	if (head) head->list.prev = obj; \
-	head = obj; \
+	piece_links_t *link_p = LINKS(obj); \
+	link_p->list.prev = 0; \
+	link_p->list.next = head; \
+	if (head) REF_LINKS(head)->list.prev = OBJ_REF(obj); \
+	head = OBJ_REF(obj); \
 }
 
 #define UNLINK(head,obj,list) { \
-	if (obj->list.next) \
-		obj->list.next->list.prev = obj->list.prev; \
-        if (obj->list.prev) \
-		obj->list.prev->list.next = obj->list.next; \
-        else head = obj->list.next; \
-	obj->list.next = NULL; /* encourage mem faults in buggy code */ \
-	obj->list.prev = NULL; \
+	piece_links_t *link_p = LINKS(obj); \
+	if (link_p->list.next) \
+		REF_LINKS(link_p->list.next)->list.prev = link_p->list.prev; \
+	if (link_p->list.prev) \
+		REF_LINKS(link_p->list.prev)->list.next = link_p->list.next; \
+	else head = link_p->list.next; \
+	link_p->list.next = 0; \
+	link_p->list.prev = 0; \
 }
 
 /* macros to set map and list of an object */
 #define MAP(owner) ((owner) == USER ? user_map : comp_map)
 #define LIST(owner) ((owner) == USER ? user_obj : comp_obj)
+#define SEEN(vmap) ((vmap) == comp_map ? comp_seen : user_seen)
+
+/*
+Besides its list, each live piece has a place in 'piece_vec', where
+the pieces are grouped by owner and type:  first the user's armies,
+then the user's fighters, and so on through the computer's
+satellites.  Group g occupies piece_vec[vec_start[g]] up to but not
+including piece_vec[vec_start[g+1]].  Pieces must not be produced or
+killed while a group is being stepped through.
+*/
+
+#define NUM_GROUPS (2*NUM_OBJECTS)
+#define VEC_GROUP(owner,type) (((owner) == USER ? 0 : NUM_OBJECTS) + (type))
+#define COUNT_PIECES(owner,type) \
+	(vec_start[VEC_GROUP(owner,type)+1] - vec_start[VEC_GROUP(owner,type)])
+
+/* macros to step through a player's pieces of one type, or of all types */
+#define FOR_VEC(first,last,p,i) \
+	for (i = (first); (i < (last) ? p = POOL_OBJ(piece_vec[i]),1 : 0); i++)
+#define FOR_PIECES(owner,type,p,i) \
+	FOR_VEC(vec_start[VEC_GROUP(owner,type)], \
+		vec_start[VEC_GROUP(owner,type)+1], p, i)
+#define FOR_ALL_PIECES(owner,p,i) \
+	FOR_VEC(vec_start[VEC_GROUP(owner,0)], \
+		vec_start[VEC_GROUP(owner,NUM_OBJECTS)], p, i)
+
+/*
+Macros to step through adjacent cells.  FOR_ADJ visits all eight
+directions.  FOR_ADJ_ON visits only the neighbours on the board, in
+the same order, by walking the bits of the cell's 'adj_mask'; the
+board is tested once, by classify_map, rather than on every visit.
+low_bit[m] is the number of the lowest bit set in m, or 8 if none.
+*/
 
-/* macro to step through adjacent cells */
 #define FOR_ADJ(loc,new_loc,i) for (i=0; (i<8 ? new_loc=loc+dir_offset[i],1 : 0); i++)
-#define FOR_ADJ_ON(loc,new_loc,i) FOR_ADJ(loc,new_loc,i) if (map[new_loc].on_board)
+#define FOR_ADJ_ON(loc,new_loc,i) \
+	for (i = low_bit[adj_mask[loc]]; \
+	     (i < 8 ? new_loc = (loc) + dir_offset[i], 1 : 0); \
+	     i += 1 + low_bit[adj_mask[loc] >> (i+1)])
 
 /*
 We maintain attributes for each piece.  Attributes are currently constant,
@@ -201,22 +286,56 @@ it tells whether or not a square is on the board.
 
 'user_map' describes the user's view of the world.  'comp_map' describes
 the computer's view of the world.
+
+The size of the map is chosen when a game is made (see set_map_size),
+and the maps and every other table with an entry per cell are
+allocated to fit.
 */
 
-#define MAP_WIDTH 100
-#define MAP_HEIGHT 60
-#define MAP_SIZE (MAP_WIDTH * MAP_HEIGHT)
+#define DEF_MAP_WIDTH 100 /* size of the map unless we are told otherwise */
+#define DEF_MAP_HEIGHT 60
+#define MIN_MAP_WIDTH 40 /* limits on the size of the map */
+#define MIN_MAP_HEIGHT 24
+#define MAX_MAP_WIDTH 2000
+#define MAX_MAP_HEIGHT 2000
 
 typedef struct real_map { /* a cell of the actual map */
 	char contents; /* '+', '.', or '*' */
 	uchar on_board; /* TRUE iff on the board */
-	city_info_t *cityp; /* ptr to city at this location */
-	piece_info_t *objp; /* list of objects at this location */
+	int cityp; /* city at this location */
+	int objp; /* list of objects at this location */
 } real_map_t;
 
-typedef struct view_map { /* a cell of one player's world view */
+typedef struct occupancy { /* a summary of the pieces in a cell */
+	int top; /* piece shown in the cell; see find_obj_at_loc */
+	short types; /* bit (1 << type) set iff a piece of that type is here */
+	short count; /* number of pieces here */
+	uchar owners; /* bit (1 << owner) set iff the owner has a piece here */
+} occupancy_t;
+
+/*
+What kind of cell each cell of the real map is, one byte per cell in
+'cell_class'.  The terrain does not change once the cities are placed,
+so classify_map fills in the table when a game is made or restored.
+*/
+
+#define CL_LAND 0x01 /* '+' */
+#define CL_WATER 0x02 /* '.' */
+#define CL_CITY 0x04 /* '*' */
+#define CL_ON_BOARD 0x08
+#define CL_SHORE 0x10 /* next to water on the board */
+#define CL_AT_SEA 0x20 /* only water on the board around */
+
+#define ON_BOARD(loc) (cell_class[loc] & CL_ON_BOARD)
+
+/*
+A cell of one player's world view.  The date each cell was last
+updated is kept apart, in 'user_seen' or 'comp_seen', so that the
+view maps, which are copied often, take one byte per cell.
+*/
+
+typedef struct view_map {
 	char contents; /* '+', '.', '*', 'A', 'a', etc */
-	long seen; /* date when last updated */
 } view_map_t;
 
 /* Define information we maintain for a pathmap. */
@@ -264,9 +383,192 @@ typedef struct {
 /* special weights */
 #define W_TT_BUILD -1 /* special cost for city building a tt */
 
+/* Phases of a turn that can be timed.  See stats.c. */
+
+#define PH_USER_MOVE 0 /* user_move */
+#define PH_COMP_MOVE 1 /* one turn of comp_move */
+#define PH_CITIES 2 /* do_cities */
+#define PH_PIECE 3 /* PH_PIECE+type is moving a computer piece */
+#define PH_PRUNE (PH_PIECE+NUM_OBJECTS) /* vmap_prune_explore_locs */
+#define PH_UNLOAD_MAP (PH_PRUNE+1) /* make_unload_map */
+#define PH_SCAN (PH_PRUNE+2) /* scan */
+#define PH_SAVE (PH_PRUNE+3) /* save_game */
+#define PH_MOVIE (PH_PRUNE+4) /* save_movie_screen */
+#define PH_PLAN (PH_PRUNE+5) /* comp_plan */
+#define NUM_PHASES (PH_PRUNE+6)
+
+/* Entry points whose stack depth we measure; see memory.c. */
+
+#define ST_USER_MOVE 0
+#define ST_COMP_MOVE 1
+#define ST_COMP_PROD 2
+#define ST_LAKE 3
+#define ST_ARMY_MOVE 4
+#define ST_MOVE_EXPLORE 5
+#define ST_MOVE_TO_DEST 6
+#define ST_PRUNE 7
+#define NUM_STACK 8
+
 /* List of cells in the perimeter of our searching for a path. */
 
 typedef struct {
 	long len; /* number of items in list */
-	long list[MAP_SIZE]; /* list of locations */
+	long *list; /* list of locations, one slot per cell of the map */
 } perimeter_t;
+
+/* Continents and pairs of continents considered for starting cities. */
+
+#define MAX_CONT 10 /* most continents we will allow */
+
+typedef struct cont { /* a continent */
+	long value; /* value of continent */
+	int ncity; /* number of cities */
+	city_info_t **cityp; /* pointer to city, room for all cities */
+} cont_t;
+
+typedef struct pair {
+	long value; /* value of pair for user */
+	int user_cont; /* index to user continent */
+	int comp_cont; /* index to computer continent */
+} pair_t;
+
+#define MAX_HEIGHT 999	/* highest height when making a map */
+
+typedef unsigned long long hash_t; /* hash of a game's state; see hash.c */
+
+/*
+Everything that belongs to one game.  The engine works on the game
+that 'game' points to, and extern.h makes the fields look like the
+globals they used to be.  A process can hold several games and switch
+between them by changing 'game'.  Constant tables such as piece_attr
+and the move_info_t objectives are shared by all games.
+
+Everything before 'obj_nchunk' is the state of play, which 'copy_game'
+copies along with the pieces, the maps and the cities; everything from
+'emap' on is scratch space.  The pool and the tables that grow with it
+are allocated by 'pool_reserve', the tables with an entry per cell
+by 'set_map_size', and those with an entry per city by 'set_city_count'.
+*/
+
+typedef struct {
+	/* parameters used to make the map */
+	int smooth; /* number of times to smooth map */
+	int water_ratio; /* percentage of map that is water */
+	int min_city_dist; /* cities must be at least this far apart */
+
+	/* the world, the players' views of it, and the pieces */
+	int map_width; /* size of the map */
+	int map_height;
+	int map_size; /* map_width * map_height */
+	int dir_offset[8]; /* offset to the cell in each direction */
+	int num_city; /* number of cities */
+	int free_list;
+	int user_obj[NUM_OBJECTS];
+	int comp_obj[NUM_OBJECTS];
+	int pool_size; /* pieces in the object pool */
+	int vec_start[NUM_GROUPS+1]; /* where each group starts in piece_vec */
+	int sector_obj[NUM_SECTORS][NUM_OBJECTS]; /* user's pieces in each
+						     sector, by type */
+	int list_count; /* pieces put on the user's lists so far */
+	int nchanged[NUM_OWNERS]; /* cells on each list of changes */
+
+	/* state of play */
+	long date; /* number of game turns played */
+	char automove;
+	char resigned;
+	char debug; /* TRUE iff in debugging mode */
+	char print_debug;
+	char print_vmap;
+	char trace_pmap;
+	int win; /* set when game is over */
+	char save_movie;
+	int user_score;
+	int comp_score;
+	int obj_used;
+	int obj_high;
+	int *prod_plan; /* production ratios chosen by comp_plan, or NULL */
+	unsigned long rng; /* random number state */
+	hash_t piece_hash; /* hash of the live pieces */
+	hash_t map_hash; /* hash of the map's terrain */
+
+	/* the object pool, and tables with an entry per piece */
+	int obj_nchunk; /* chunks allocated; keep first */
+	piece_info_t **obj_chunk; /* chunks of POOL_CHUNK pieces */
+	piece_links_t **link_chunk; /* and their links */
+	int *piece_vec; /* live pieces by owner and type */
+	int *vec_pos; /* where each piece is in piece_vec */
+	int *sector_next; /* links of the lists in sector_obj */
+	int *sector_prev;
+	int *list_seq; /* list_count when each user piece went on its list */
+
+	/* tables with an entry per cell of the map */
+	int map_alloc; /* cells allocated */
+	real_map_t *map; /* the way the world really looks */
+	occupancy_t *occupancy; /* what is in each cell of map */
+	uchar *cell_class; /* CL_ bits for each cell of map */
+	uchar *adj_mask; /* bit i set iff the cell in direction i is on board */
+	view_map_t *comp_map;
+	view_map_t *user_map;
+	int *comp_seen; /* date each cell of comp_map was updated */
+	int *user_seen;
+	uchar *changed; /* bit (1 << owner) set iff owner has yet to look */
+	int *changes[NUM_OWNERS]; /* cells changed since each player (or,
+				     for UNOWNED, the checker) last looked */
+	int *cell_row; /* row and column of each cell */
+	int *cell_col;
+	path_map_t *pmap_init; /* blank path map; see start_perimeter */
+
+	/* tables with an entry per city, and the grid of cities */
+	int city_alloc; /* cities allocated */
+	city_info_t *city; /* city information */
+	int *city_next; /* next city in the same square with the same owner */
+	int grid_rows, grid_cols; /* size of the grid */
+	int grid_alloc; /* entries allocated in city_grid */
+	int *city_grid; /* first city in each square, for each owner */
+	int owned_cities[NUM_OWNERS]; /* number of cities each owner has */
+	city_info_t **cont_cities; /* room for the cities of each continent */
+
+	/* scratch space for moving pieces (compmove.c, usermove.c) */
+	view_map_t *emap; /* pruned explore map */
+	view_map_t *amap; /* temp view map */
+	path_map_t *path_map; /* shared by the user's and computer's moves */
+	path_map_t *path_map2; /* second path map for army_move */
+	int *owncont_map;
+	int *tcont_map;
+	int *prod_cont; /* continent maps for comp_prod and lake */
+	int *lake_cont;
+
+	/* scratch space for path searches (map.c) */
+	perimeter_t p1, p2, p3, p4;
+	path_map_t *prune_pmap; /* counts for vmap_prune_explore_locs */
+	int best_cost; /* cost and location of best objective */
+	long best_loc;
+
+	/* scratch space for making the map (game.c) */
+	int *height[2];
+	int height_count[MAX_HEIGHT+1];
+	long *land;
+	int *land_row; /* row and column of each cell of 'land' */
+	int *land_col;
+	int *land_dist; /* distance of each cell of 'land' from a city */
+	int *marked; /* list of examined cells */
+	long *flood; /* stack for marking a continent */
+	int ncont;
+	cont_t cont_tab[MAX_CONT];
+	int rank_tab[MAX_CONT];
+	pair_t pair_tab[MAX_CONT*MAX_CONT];
+	char *mapbuf; /* movie frame */
+
+	/* scratch space for scan_radius (object.c) */
+	int *scan_stamp; /* number of the last scan that updated each cell */
+	int scan_count; /* number of the current scan */
+
+	/* scratch space for consistency checks (util.c) */
+	int *in_free;
+	int *in_obj;
+	int *in_loc;
+	int *in_cargo;
+	int *touched; /* TRUE if a piece has changed since the last check */
+	int *touch_list; /* the pieces that have */
+	int ntouched;
+} game_t;
@@ -11,29 +11,61 @@
 extern.h -- define global non-constant storage.
 */
 
+/*
+The state of a game lives in a game_t (see empire.h).  These macros
+let the rest of the program refer to the fields of the current game
+as if they were globals.
+*/
+
+game_t *game; /* the game being played */
+
 /* user-supplied parameters */
-int SMOOTH;        /* number of times to smooth map */
-int WATER_RATIO;   /* percentage of map that is water */
-int MIN_CITY_DIST; /* cities must be at least this far apart */
+#define SMOOTH (game->smooth)
+#define WATER_RATIO (game->water_ratio)
+#define MIN_CITY_DIST (game->min_city_dist)
 int delay_time;
 int save_interval; /* turns between autosaves */
+long batch_turns; /* turns to play without a display, or 0 */
+char batch_memory; /* TRUE iff we print a memory report after batch play */
+long batch_seed; /* random seed for batch play, or 0 to use the clock */
+int batch_level; /* difficulty level for batch play */
+char batch_hash; /* TRUE iff we print the state hash after each batch turn */
+int plan_horizon; /* turns the computer looks ahead when choosing production */
+char checking; /* TRUE iff we check the pieces and cells that change */
+int check_interval; /* turns between checks of everything, or 0 */
+long check_errors; /* problems the checks have found */
 
-real_map_t map[MAP_SIZE]; /* the way the world really looks */
-view_map_t comp_map[MAP_SIZE]; /* computer's view of the world */
-view_map_t user_map[MAP_SIZE]; /* user's view of the world */
+#define MAP_WIDTH (game->map_width) /* size of the map */
+#define MAP_HEIGHT (game->map_height)
+#define MAP_SIZE (game->map_size)
+#define dir_offset (game->dir_offset) /* offset to each adjacent cell */
 
-city_info_t city[NUM_CITY]; /* city information */
+#define occupancy (game->occupancy) /* a summary of the pieces in each cell */
+#define cell_class (game->cell_class) /* what kind of cell each cell is */
+#define adj_mask (game->adj_mask) /* which neighbours are on the board */
+#define comp_map (game->comp_map) /* computer's view of the world */
+#define user_map (game->user_map) /* user's view of the world */
+#define comp_seen (game->comp_seen) /* when computer last saw each cell */
+#define user_seen (game->user_seen) /* when user last saw each cell */
+
+#define NUM_CITY (game->num_city) /* number of cities */
+#define owned_cities (game->owned_cities) /* cities each owner has */
 
 /*
-There is one array to hold all allocated objects no matter who
-owns them.  Objects are allocated from the array and placed on
+There is one pool to hold all allocated objects no matter who
+owns them.  Objects are allocated from the pool and placed on
 a list corresponding to the type of object and its owner.
 */
 
-piece_info_t *free_list; /* index to free items in object list */
-piece_info_t *user_obj[NUM_OBJECTS]; /* indices to user lists */
-piece_info_t *comp_obj[NUM_OBJECTS]; /* indices to computer lists */
-piece_info_t object[LIST_SIZE]; /* object list */
+#define free_list (game->free_list) /* index to free items in object list */
+#define user_obj (game->user_obj) /* indices to user lists */
+#define comp_obj (game->comp_obj) /* indices to computer lists */
+#define obj_chunk (game->obj_chunk) /* object pool */
+#define link_chunk (game->link_chunk) /* links of objects in pool */
+#define pool_size (game->pool_size) /* number of objects in pool */
+#define piece_vec (game->piece_vec) /* dense index of live pieces */
+#define vec_start (game->vec_start)
+#define vec_pos (game->vec_pos)
 
 /* Display information. */
 int lines; /* lines on screen */
@@ -41,10 +73,10 @@ int cols; /* columns on screen */
 
 /* constant data */
 extern piece_attr_t piece_attr[];
-extern int dir_offset[];
 extern char *func_name[];
 extern int move_order[];
 extern char type_chars[];
+extern uchar low_bit[];
 extern char tt_attack[];
 extern char army_attack[];
 extern char fighter_attack[];
@@ -72,26 +104,31 @@ extern int edit_lines;
 extern int user_lines;
 
 /* miscellaneous */
-long date; /* number of game turns played */
-char automove; /* TRUE iff user is in automove mode */
-char resigned; /* TRUE iff computer resigned */
-char debug; /* TRUE iff in debugging mode */
-char print_debug; /* TRUE iff we print debugging stuff */
-char print_vmap; /* TRUE iff we print view maps */
-char trace_pmap; /* TRUE if we are tracing pmaps */
-int win; /* set when game is over */
+#define automove (game->automove) /* TRUE iff user is in automove mode */
+#define resigned (game->resigned) /* TRUE iff computer resigned */
+#define print_debug (game->print_debug) /* TRUE iff we print debugging stuff */
+#define print_vmap (game->print_vmap) /* TRUE iff we print view maps */
+#define trace_pmap (game->trace_pmap) /* TRUE if we are tracing pmaps */
 char jnkbuf[STRSIZE]; /* general purpose temporary buffer */
-char save_movie; /* TRUE iff we should save movie screens */
-int user_score; /* "score" for user and computer */
-int comp_score;
+#define save_movie (game->save_movie) /* TRUE iff we should save movie screens */
+#define user_score (game->user_score) /* "score" for user and computer */
+#define comp_score (game->comp_score)
+#define obj_used (game->obj_used) /* objects currently in use */
+#define obj_high (game->obj_high) /* most objects ever in use at once */
+#define prod_plan (game->prod_plan) /* production ratios to use, or NULL */
+long expand_count; /* cells expanded by map searches */
+char timing; /* TRUE iff we time the phases of each turn */
+char tracing; /* TRUE iff we record a timeline of each turn */
+char stack_probing; /* TRUE iff we measure stack depth */
+char rolling_out; /* TRUE while a rollout is played; nothing is shown */
 
 /* Screen updating macros */
 #define display_loc_u(loc) display_loc(USER,user_map,loc)
 #define display_loc_c(loc) display_loc(COMP,comp_map,loc)
 #define print_sector_u(sector) print_sector(USER,user_map,sector)
 #define print_sector_c(sector) print_sector(COMP,comp_map,sector)
-#define loc_row(loc) ((loc)/MAP_WIDTH)
-#define loc_col(loc) ((loc)%MAP_WIDTH)
+#define loc_row(loc) (game->cell_row[loc]) /* looked up, not divided out */
+#define loc_col(loc) (game->cell_col[loc])
 #define row_col_loc(row,col) ((long)((row)*MAP_WIDTH + (col)))
 #define sector_row(sector) ((sector)%SECTOR_ROWS)
 #define sector_col(sector) ((sector)/SECTOR_ROWS)
@@ -104,6 +141,19 @@ int comp_score;
 #define sector_loc(sector) row_col_loc( \
 		sector_row(sector)*ROWS_PER_SECTOR+ROWS_PER_SECTOR/2, \
 		sector_col(sector)*COLS_PER_SECTOR+COLS_PER_SECTOR/2)
+
+/* Phase timing macros; these cost one test when timing is off. */
+#define phase_begin() (timing ? stats_now () : 0L)
+#define phase_end(phase,start) { if (timing) stats_phase (phase, start); }
+
+/* Timeline tracing macros; likewise cheap when tracing is off. */
+#define trace_begin() (tracing ? stats_now () : 0L)
+#define trace_end(name,start,n1,a1,n2,a2) \
+	{ if (tracing) trace_span (name, start, n1, (long)(a1), n2, (long)(a2)); }
+
+/* Stack depth macros; again cheap when not measuring. */
+#define stack_enter(entry) { if (stack_probing) stack_mark (entry); }
+#define stack_probe() { if (stack_probing) stack_mark (-1); }
 		
 /* global routines */
 
@@ -137,6 +187,7 @@ int vmap_shore (view_map_t *vmap, long loc);
 int rmap_shore (long loc);
 int vmap_at_sea (view_map_t *vmap, long loc);
 int rmap_at_sea (long loc);
+int terrain_class (char *terrain);
 
 void kill_display (); /* display routines */
 void sector_change ();
@@ -155,6 +206,14 @@ void init_colors ();
 #endif /* A_COLOR */
 
 void init_game (); /* game routines */
+game_t *alloc_game ();
+void free_game (game_t *g);
+int pool_reserve (int size);
+int set_map_size (int width, int height);
+int set_city_count (int n);
+int copy_game (game_t *to, game_t *from);
+game_t *clone_game (game_t *from);
+void classify_map ();
 void save_game ();
 int restore_game ();
 void save_movie_screen ();
@@ -170,11 +229,15 @@ int getyn (char *message);
 int get_range (char *message, int low, int high);
 
 void rndini (); /* math routines */
+void rndset (long seed);
 long irand (long high);
 int dist (long a, long b);
+void dist_list (long loc, int *rows, int *cols, long n, int *d);
 int isqrt (int n);
 
 int find_nearest_city (long loc, int owner, long *city_loc);
+void city_grid_reset ();
+void set_city_owner (city_info_t *cityp, int owner);
 city_info_t *find_city (long loc); /* object routines */
 piece_info_t *find_obj (int type, long loc);
 piece_info_t *find_nfull (int type, long loc);
@@ -190,9 +253,15 @@ void move_sat (piece_info_t *obj);
 int good_loc (piece_info_t *obj, long loc);
 void embark (piece_info_t *ship, piece_info_t *obj);
 void disembark (piece_info_t *obj);
+void vec_add (piece_info_t *obj);
+void vec_remove (piece_info_t *obj);
 void describe_obj (piece_info_t *obj);
 void scan (view_map_t vmap[], long loc);
-void scan_sat (view_map_t *vmap, long loc);
+void scan_radius (view_map_t *vmap, long loc, int radius);
+void cell_changed (long loc);
+void all_changed ();
+void sector_reset ();
+void scan_changes (int owner);
 void set_prod (city_info_t *cityp);
 
 /* terminal routines */
@@ -218,6 +287,7 @@ void ksend1 (char *buf, char *a, int b, int c, int d, int e, int f, int g, int h
 
 /* utility routines */
 void ttinit ();
+void fit_screen ();
 void redraw ();
 void clear_screen ();
 void delay ();
@@ -233,6 +303,39 @@ void ver ();
 char upper (char c);
 void tupper (char *str);
 void check ();
+void check_recent ();
+void touch_piece (piece_info_t *obj);
+
+/* statistics routines */
+long stats_now ();
+void stats_phase (int phase, long start);
+void stats_enable (int on);
+void stats_turn ();
+void stats_display ();
+void stats_search (move_info_t *move_info);
+void stats_perimeter (long len);
+void stats_objective (int found);
+void stats_search_display ();
+
+/* trace routines */
+void trace_open (char *file);
+void trace_span (char *name, long start, char *name1, long arg1, char *name2, long arg2);
+void trace_flush ();
+
+/* hash routines */
+void hash_piece (piece_info_t *obj);
+void set_func (piece_info_t *obj, long func);
+hash_t hash_pieces ();
+void hash_reset ();
+hash_t state_hash ();
+
+/* rollout routines */
+long rollout (int *plan, int turns);
+
+/* memory accounting routines */
+void stack_mark (int entry);
+void stack_enable (int on);
+void mem_report (int print);
 
 /* randon routines we use */
 long time();
@@ -17,6 +17,8 @@ game.c -- Routines to initialize, save, and restore a game.
 #include <strings.h>
 #endif
 
+#include <stdlib.h>
+#include <stddef.h>
 #include <ctype.h>
 #include <curses.h>
 #include "empire.h"
@@ -24,6 +26,438 @@ game.c -- Routines to initialize, save, and restore a game.
 
 long remove_land(long loc, long num_land);
 
+/*
+Allocate an empty game with a map of the usual size.  The caller
+makes it current by pointing 'game' at it, and then initializes or
+restores it.  Returns NULL if there is no memory.
+*/
+
+game_t *
+alloc_game ()
+{
+	game_t *g, *real;
+
+	g = (game_t *) calloc (1, sizeof (game_t));
+	if (g == NULL) return (NULL);
+
+	real = game;
+	game = g;
+	if (!set_map_size (DEF_MAP_WIDTH, DEF_MAP_HEIGHT)
+	 || !set_city_count (DEF_NUM_CITY)) {
+		free_game (g);
+		g = NULL;
+	}
+	game = real;
+	return (g);
+}
+
+/*
+Release a game.  If it is the current game, there is no longer one.
+*/
+
+void
+free_game (g)
+game_t *g;
+{
+	game_t *real;
+	int i;
+
+	real = game;
+	game = g;
+	for (i = 0; i < game->obj_nchunk; i++) {
+		free ((char *)obj_chunk[i]);
+		free ((char *)link_chunk[i]);
+	}
+	free ((char *)obj_chunk);
+	free ((char *)link_chunk);
+	free ((char *)piece_vec);
+	free ((char *)vec_pos);
+	free ((char *)game->sector_next);
+	free ((char *)game->sector_prev);
+	free ((char *)game->list_seq);
+	free ((char *)game->in_free);
+	free ((char *)game->in_obj);
+	free ((char *)game->in_loc);
+	free ((char *)game->in_cargo);
+	free ((char *)game->touched);
+	free ((char *)game->touch_list);
+
+	free ((char *)game->map);
+	free ((char *)occupancy);
+	free ((char *)cell_class);
+	free ((char *)adj_mask);
+	free ((char *)comp_map);
+	free ((char *)user_map);
+	free ((char *)comp_seen);
+	free ((char *)user_seen);
+	free ((char *)game->changed);
+	for (i = 0; i < NUM_OWNERS; i++)
+		free ((char *)game->changes[i]);
+	free ((char *)game->cell_row);
+	free ((char *)game->cell_col);
+	free ((char *)game->pmap_init);
+	free ((char *)game->emap);
+	free ((char *)game->amap);
+	free ((char *)game->path_map);
+	free ((char *)game->path_map2);
+	free ((char *)game->owncont_map);
+	free ((char *)game->tcont_map);
+	free ((char *)game->prod_cont);
+	free ((char *)game->lake_cont);
+	free ((char *)game->p1.list);
+	free ((char *)game->p2.list);
+	free ((char *)game->p3.list);
+	free ((char *)game->p4.list);
+	free ((char *)game->prune_pmap);
+	free ((char *)game->height[0]);
+	free ((char *)game->land);
+	free ((char *)game->land_row);
+	free ((char *)game->land_col);
+	free ((char *)game->land_dist);
+	free ((char *)game->marked);
+	free ((char *)game->flood);
+	free ((char *)game->mapbuf);
+	free ((char *)game->scan_stamp);
+	free ((char *)game->city);
+	free ((char *)game->city_next);
+	free ((char *)game->city_grid);
+	free ((char *)game->cont_cities);
+	free ((char *)game);
+	game = (real == g) ? NULL : real;
+}
+
+/*
+Make a table with an entry per piece big enough for 'n' chunks.
+Returns FALSE if there is no memory.
+*/
+
+static int
+grow_table (tab, n)
+int **tab;
+int n;
+{
+	int *p;
+
+	p = (int *) realloc ((char *)*tab, n * POOL_CHUNK * sizeof (int));
+	if (p == NULL) return (FALSE);
+	*tab = p;
+	return (TRUE);
+}
+
+/*
+Make sure the current game has room for 'size' pieces in its object
+pool.  Chunks are only ever added, so a piece stays where it is as the
+pool grows, and a game that is reused keeps the chunks it has.  The
+new pieces are not put on the free list; that is up to the caller.
+Returns FALSE if there is no memory.
+*/
+
+int
+pool_reserve (size)
+int size;
+{
+	piece_info_t **chunk, *objs;
+	piece_links_t **lchunk, *links;
+	int n;
+
+	n = (size + POOL_CHUNK - 1) / POOL_CHUNK; /* chunks needed */
+	if (n <= game->obj_nchunk) return (TRUE);
+
+	chunk = (piece_info_t **) realloc ((char *)obj_chunk,
+			n * sizeof (piece_info_t *));
+	if (chunk == NULL) return (FALSE);
+	obj_chunk = chunk;
+	lchunk = (piece_links_t **) realloc ((char *)link_chunk,
+			n * sizeof (piece_links_t *));
+	if (lchunk == NULL) return (FALSE);
+	link_chunk = lchunk;
+
+	if (!grow_table (&piece_vec, n) || !grow_table (&vec_pos, n)
+	 || !grow_table (&game->sector_next, n)
+	 || !grow_table (&game->sector_prev, n)
+	 || !grow_table (&game->list_seq, n)
+	 || !grow_table (&game->in_free, n) || !grow_table (&game->in_obj, n)
+	 || !grow_table (&game->in_loc, n) || !grow_table (&game->in_cargo, n)
+	 || !grow_table (&game->touched, n) || !grow_table (&game->touch_list, n))
+		return (FALSE);
+	(void) bzero ((char *)(game->touched + game->obj_nchunk * POOL_CHUNK),
+		(n - game->obj_nchunk) * POOL_CHUNK * sizeof (int));
+
+	while (game->obj_nchunk < n) {
+		objs = (piece_info_t *) calloc (POOL_CHUNK, sizeof (piece_info_t));
+		links = (piece_links_t *) calloc (POOL_CHUNK, sizeof (piece_links_t));
+		if (objs == NULL || links == NULL) {
+			free ((char *)objs);
+			free ((char *)links);
+			return (FALSE);
+		}
+		chunk[game->obj_nchunk] = objs;
+		lchunk[game->obj_nchunk] = links;
+		game->obj_nchunk++;
+	}
+	return (TRUE);
+}
+
+/*
+Make sure a table with an entry per cell has room for 'n' entries of
+'size' bytes.  Returns FALSE if there is no memory.
+*/
+
+static int
+grow_cells (tab, n, size)
+char **tab;
+int n;
+int size;
+{
+	char *p;
+
+	p = (char *) realloc (*tab, (long)n * size);
+	if (p == NULL) return (FALSE);
+	*tab = p;
+	return (TRUE);
+}
+
+#define GROW(tab,n) grow_cells ((char **)&(tab), (n), sizeof (*(tab)))
+
+/*
+Make sure the current game has room for a map of 'n' cells.  As with
+the object pool, the tables only ever grow, so a game that is reused
+for a smaller map keeps what it has.  Returns FALSE if there is no
+memory.
+*/
+
+static int
+map_reserve (n)
+int n;
+{
+	int i;
+
+	if (n <= game->map_alloc) return (TRUE);
+
+	if (!GROW (game->map, n) || !GROW (occupancy, n) || !GROW (cell_class, n) || !GROW (adj_mask, n)
+	 || !GROW (comp_map, n) || !GROW (user_map, n)
+	 || !GROW (comp_seen, n) || !GROW (user_seen, n)
+	 || !GROW (game->changed, n)
+	 || !GROW (game->changes[UNOWNED], n)
+	 || !GROW (game->changes[USER], n) || !GROW (game->changes[COMP], n)
+	 || !GROW (game->cell_row, n) || !GROW (game->cell_col, n)
+	 || !GROW (game->pmap_init, n)
+	 || !GROW (game->emap, n) || !GROW (game->amap, n)
+	 || !GROW (game->path_map, n) || !GROW (game->path_map2, n)
+	 || !GROW (game->owncont_map, n) || !GROW (game->tcont_map, n)
+	 || !GROW (game->prod_cont, n) || !GROW (game->lake_cont, n)
+	 || !GROW (game->p1.list, n) || !GROW (game->p2.list, n)
+	 || !GROW (game->p3.list, n) || !GROW (game->p4.list, n)
+	 || !GROW (game->prune_pmap, n)
+	 || !GROW (game->land, n) || !GROW (game->land_row, n)
+	 || !GROW (game->land_col, n) || !GROW (game->land_dist, n)
+	 || !GROW (game->marked, n)
+	 || !GROW (game->flood, n) || !GROW (game->mapbuf, n)
+	 || !GROW (game->scan_stamp, n))
+		return (FALSE);
+
+	/* both height maps live in one block */
+	if (!GROW (game->height[0], 2 * n)) return (FALSE);
+	game->height[1] = game->height[0] + n;
+
+	for (i = 0; i < n; i++) { /* everything lies outside perim */
+		game->pmap_init[i].cost = INFINITY;
+		game->pmap_init[i].inc_cost = 0;
+		game->pmap_init[i].terrain = T_UNKNOWN;
+	}
+	(void) bzero ((char *)game->scan_stamp, n * sizeof (int));
+	game->scan_count = 0; /* no cell has been stamped */
+	game->map_alloc = n;
+	return (TRUE);
+}
+
+/*
+Set the size of the current game's map, and make room for it.  The
+row and column of each cell are worked out here, once, so that
+loc_row and loc_col need not divide.  The caller checks the size
+against the limits in empire.h.  Returns FALSE if there is no memory,
+in which case the size is unchanged.
+*/
+
+int
+set_map_size (width, height)
+int width, height;
+{
+	int rows, cols;
+	long i;
+
+	rows = (height + CITY_GRID - 1) / CITY_GRID;
+	cols = (width + CITY_GRID - 1) / CITY_GRID;
+	if (!map_reserve (width * height)) return (FALSE);
+	if (NUM_OWNERS * rows * cols > game->grid_alloc) {
+		if (!GROW (game->city_grid, NUM_OWNERS * rows * cols))
+			return (FALSE);
+		game->grid_alloc = NUM_OWNERS * rows * cols;
+	}
+	game->grid_rows = rows;
+	game->grid_cols = cols;
+
+	if (width != MAP_WIDTH || height != MAP_HEIGHT) { /* new shape */
+		for (i = 0; i < width * height; i++) {
+			game->cell_row[i] = i / width;
+			game->cell_col[i] = i % width;
+		}
+	}
+	MAP_WIDTH = width;
+	MAP_HEIGHT = height;
+	MAP_SIZE = width * height;
+
+	dir_offset[0] = -width; /* north */
+	dir_offset[1] = -width+1; /* northeast */
+	dir_offset[2] = 1; /* east */
+	dir_offset[3] = width+1; /* southeast */
+	dir_offset[4] = width; /* south */
+	dir_offset[5] = width-1; /* southwest */
+	dir_offset[6] = -1; /* west */
+	dir_offset[7] = -width-1; /* northwest */
+	return (TRUE);
+}
+
+/*
+Set the number of cities in the current game, and make room for them.
+The caller checks the number against the limits in empire.h.  Returns
+FALSE if there is no memory, in which case the number is unchanged.
+*/
+
+int
+set_city_count (n)
+int n;
+{
+	int i;
+
+	if (n > game->city_alloc) {
+		if (!GROW (game->city, n) || !GROW (game->city_next, n)
+		 || !GROW (game->cont_cities, MAX_CONT * n))
+			return (FALSE);
+		for (i = 0; i < MAX_CONT; i++)
+			game->cont_tab[i].cityp = game->cont_cities + i * n;
+		game->city_alloc = n;
+	}
+	NUM_CITY = n;
+	return (TRUE);
+}
+
+/*
+Copy the state of one game into another, either to take a snapshot
+we can return to or to make a clone we can play ahead on.  Only the
+state of play is copied, not the scratch space.  Pieces and cities
+refer to each other by number, so the copy needs no fixing up; the
+pieces themselves are copied chunk by chunk, and the maps and cities
+array by array.  The grid of cities is made again rather than copied.
+Returns FALSE if there is no memory.
+*/
+
+#define GAME_STATE_SIZE offsetof (game_t, obj_nchunk)
+
+int
+copy_game (to, from)
+game_t *to, *from;
+{
+	game_t *real;
+	piece_info_t **chunk;
+	piece_links_t **lchunk;
+	int *vec, *pos, *snext, *sprev, *seq;
+	real_map_t *rmap;
+	occupancy_t *occ;
+	uchar *class, *adj, *chg;
+	view_map_t *cmap, *umap;
+	int *cseen, *useen, *changes[NUM_OWNERS];
+	city_info_t *cities;
+	int size, i;
+
+	if (to == from) return (TRUE);
+	real = game;
+	game = from;
+	size = pool_size;
+	chunk = obj_chunk;
+	lchunk = link_chunk;
+	vec = piece_vec;
+	pos = vec_pos;
+	snext = game->sector_next;
+	sprev = game->sector_prev;
+	seq = game->list_seq;
+	rmap = game->map;
+	occ = occupancy;
+	class = cell_class;
+	adj = adj_mask;
+	cmap = comp_map;
+	umap = user_map;
+	cseen = comp_seen;
+	useen = user_seen;
+	chg = game->changed;
+	for (i = 0; i < NUM_OWNERS; i++)
+		changes[i] = game->changes[i];
+	cities = game->city;
+
+	game = to;
+	if (!pool_reserve (size)
+	 || !set_map_size (from->map_width, from->map_height)
+	 || !set_city_count (from->num_city)) {
+		game = real;
+		return (FALSE);
+	}
+	(void) memcpy ((char *)to, (char *)from, GAME_STATE_SIZE);
+
+	(void) memcpy ((char *)game->map, (char *)rmap, MAP_SIZE * sizeof (real_map_t));
+	(void) memcpy ((char *)occupancy, (char *)occ, MAP_SIZE * sizeof (occupancy_t));
+	(void) memcpy ((char *)cell_class, (char *)class, MAP_SIZE * sizeof (uchar));
+	(void) memcpy ((char *)adj_mask, (char *)adj, MAP_SIZE * sizeof (uchar));
+	(void) memcpy ((char *)comp_map, (char *)cmap, MAP_SIZE * sizeof (view_map_t));
+	(void) memcpy ((char *)user_map, (char *)umap, MAP_SIZE * sizeof (view_map_t));
+	(void) memcpy ((char *)comp_seen, (char *)cseen, MAP_SIZE * sizeof (int));
+	(void) memcpy ((char *)user_seen, (char *)useen, MAP_SIZE * sizeof (int));
+	(void) memcpy ((char *)game->changed, (char *)chg, MAP_SIZE * sizeof (uchar));
+	for (i = 0; i < NUM_OWNERS; i++)
+		(void) memcpy ((char *)game->changes[i], (char *)changes[i],
+				game->nchanged[i] * sizeof (int));
+	(void) memcpy ((char *)game->city, (char *)cities, NUM_CITY * sizeof (city_info_t));
+	city_grid_reset ();
+
+	for (i = 0; i < size / POOL_CHUNK; i++) {
+		(void) memcpy ((char *)obj_chunk[i], (char *)chunk[i],
+				POOL_CHUNK * sizeof (piece_info_t));
+		(void) memcpy ((char *)link_chunk[i], (char *)lchunk[i],
+				POOL_CHUNK * sizeof (piece_links_t));
+	}
+	if (size > 0) { /* the tables are not made until the pool is */
+		(void) memcpy ((char *)piece_vec, (char *)vec,
+				vec_start[NUM_GROUPS] * sizeof (int));
+		(void) memcpy ((char *)vec_pos, (char *)pos, size * sizeof (int));
+		(void) memcpy ((char *)game->sector_next, (char *)snext,
+				size * sizeof (int));
+		(void) memcpy ((char *)game->sector_prev, (char *)sprev,
+				size * sizeof (int));
+		(void) memcpy ((char *)game->list_seq, (char *)seq,
+				size * sizeof (int));
+	}
+	game = real;
+	return (TRUE);
+}
+
+/*
+Make a new game that is a copy of 'from'.  Returns NULL if there
+is no memory.
+*/
+
+game_t *
+clone_game (from)
+game_t *from;
+{
+	game_t *g;
+
+	g = alloc_game ();
+	if (g != NULL && !copy_game (g, from)) {
+		free_game (g);
+		g = NULL;
+	}
+	return (g);
+}
+
 /*
 Initialize a new game.  Here we generate a new random map, put cities
 on the map, select cities for each opponent, and zero out the lists of
@@ -38,43 +472,50 @@ void init_game () {
 	kill_display (); /* nothing on screen */
 	automove = FALSE;
 	resigned = FALSE;
-	debug = FALSE;
+	game->debug = FALSE;
 	print_debug = FALSE;
 	print_vmap = FALSE;
 	trace_pmap = FALSE;
 	save_movie = FALSE;
-	win = 0;
-	date = 0; /* no date yet */
+	game->win = 0;
+	game->date = 0; /* no date yet */
 	user_score = 0;
 	comp_score = 0;
+	prod_plan = NULL; /* usual production ratios */
 	
 	for (i = 0; i < MAP_SIZE; i++) {
 		user_map[i].contents = ' '; /* nothing seen yet */
-		user_map[i].seen = 0;
+		user_seen[i] = 0;
 		comp_map[i].contents = ' ';
-		comp_map[i].seen = 0;
+		comp_seen[i] = 0;
 	}
 	for (i = 0; i < NUM_OBJECTS; i++) {
-		user_obj[i] = NULL;
-		comp_obj[i] = NULL;
-	}
-	free_list = NULL; /* nothing free yet */
-	for (i = 0; i < LIST_SIZE; i++) { /* for each object */
-		piece_info_t *obj = &(object[i]);
-		obj->hits = 0; /* mark object as dead */
-		obj->owner = UNOWNED;
-		LINK (free_list, obj, piece_link); 
+		user_obj[i] = 0;
+		comp_obj[i] = 0;
 	}
+	free_list = 0; /* nothing free yet */
+	for (i = 0; i <= NUM_GROUPS; i++)
+		vec_start[i] = 0; /* no pieces in index */
+	obj_used = 0;
+	obj_high = 0;
+	pool_size = 0; /* pool grows as pieces are built */
+	sector_reset (); /* no pieces in any sector */
 
 	make_map (); /* make land and water */
 
 	do {
 		for (i = 0; i < MAP_SIZE; i ++) { /* remove cities */
-			if (map[i].contents == '*')
-				map[i].contents = '+'; /* land */
+			if (game->map[i].contents == '*')
+				game->map[i].contents = '+'; /* land */
+			game->map[i].cityp = 0;
 		}
 		place_cities (); /* place cities on map */
+		classify_map ();
+		city_grid_reset ();
 	} while (!select_cities ()); /* choose a city for each player */
+
+	hash_reset ();
+	all_changed ();
 }
 
 /*
@@ -89,31 +530,27 @@ and the ratio of land to water.  The user can provide these numbers
 at program start up.
 */
 
-#define MAX_HEIGHT 999	/* highest height */
-
-/* these arrays give some compilers problems when they are automatic */
-static int height[2][MAP_SIZE];
-static int height_count[MAX_HEIGHT+1];
+#define height_count (game->height_count)
 
 void make_map () {
 	int from, to, k;
 	long i, j, sum, loc;
 
 	for (i = 0; i < MAP_SIZE; i++) /* fill map with random sand */
-		height[0][i] = irand (MAX_HEIGHT);
+		game->height[0][i] = irand (MAX_HEIGHT);
 
 	from = 0;
 	to = 1;
 	for (i = 0; i < SMOOTH; i++) { /* smooth the map */
 	    for (j = 0; j < MAP_SIZE; j++) {
-		sum = height[from][j];
+		sum = game->height[from][j];
 		for (k = 0; k < 8; k++) {
 			loc = j + dir_offset[k];
 			/* edges get smoothed in a wierd fashion */
 			if (loc < 0 || loc >= MAP_SIZE) loc = j;
-			sum += height[from][loc];
+			sum += game->height[from][loc];
 		}
-		height[to][j] = sum / 9;
+		game->height[to][j] = sum / 9;
 	    }
 	    k = to; /* swap to and from */
 	    to = from;
@@ -124,8 +561,8 @@ void make_map () {
 	for (i = 0; i <= MAX_HEIGHT; i++)
 		height_count[i] = 0;
 
-	for (i = 0; i <= MAP_SIZE; i++)
-		height_count[height[from][i]]++;
+	for (i = 0; i < MAP_SIZE; i++)
+		height_count[game->height[from][i]]++;
 
 	/* find the water line */
 	loc = MAX_HEIGHT; /* default to all water */
@@ -140,19 +577,20 @@ void make_map () {
 
 	/* mark the land and water */
 	for (i = 0; i < MAP_SIZE; i ++) {
-		if (height[from][i] > loc)
-			map[i].contents = '+'; /* land */
-		else map[i].contents = '.'; /* water */
+		if (game->height[from][i] > loc)
+			game->map[i].contents = '+'; /* land */
+		else game->map[i].contents = '.'; /* water */
 
-		map[i].objp = NULL; /* nothing in cell yet */
-		map[i].cityp = NULL;
+		game->map[i].objp = 0; /* nothing in cell yet */
+		game->map[i].cityp = 0;
 
 		j = loc_col (i);
 		k = loc_row (i);
 
-		map[i].on_board = !(j == 0 || j == MAP_WIDTH-1 
+		game->map[i].on_board = !(j == 0 || j == MAP_WIDTH-1 
 				 || k == 0 || k == MAP_HEIGHT-1);
 	}
+	(void) bzero ((char *)occupancy, MAP_SIZE * sizeof (occupancy_t));
 }
 
 /*
@@ -163,8 +601,9 @@ list until all the cities are placed.  After each choice of a land cell
 for a city, we remove land cells which are too close to the city.
 */
 
-/* avoid compiler problems with large automatic arrays */
-static long land[MAP_SIZE];
+#define land_row (game->land_row)
+#define land_col (game->land_col)
+#define land_dist (game->land_dist)
 
 void place_cities () {
 	long regen_land();
@@ -177,18 +616,18 @@ void place_cities () {
 	while (placed < NUM_CITY) {
 		while (num_land == 0) num_land = regen_land (placed);
 		i = irand (num_land-1); /* select random piece of land */
-		loc = land[i];
+		loc = game->land[i];
 		
-		city[placed].loc = loc;
-		city[placed].owner = UNOWNED;
-		city[placed].work = 0;
-		city[placed].prod = NOPIECE;
+		game->city[placed].loc = loc;
+		game->city[placed].owner = UNOWNED;
+		game->city[placed].work = 0;
+		game->city[placed].prod = NOPIECE;
 		
 		for (i = 0; i < NUM_OBJECTS; i++)
-			city[placed].func[i] = NOFUNC; /* no function */
+			game->city[placed].func[i] = NOFUNC; /* no function */
 			
-		map[loc].contents = '*';
-		map[loc].cityp = &(city[placed]);
+		game->map[loc].contents = '*';
+		game->map[loc].cityp = CITY_REF (&game->city[placed]);
 		placed++;
 
 		/* Now remove any land too close to selected land. */
@@ -196,6 +635,45 @@ void place_cities () {
 	}
 }
 
+/*
+Fill in the class of each cell of the map from its terrain, and note
+which of its neighbours are on the board.  This is the one place the
+neighbours are checked against the edges of the map.
+*/
+
+void
+classify_map ()
+{
+	long i, j;
+	int k, bits, water, all_water;
+
+	for (i = 0; i < MAP_SIZE; i++) {
+		switch (game->map[i].contents) {
+		case '+': bits = CL_LAND; break;
+		case '.': bits = CL_WATER; break;
+		default: bits = CL_CITY; break;
+		}
+		if (game->map[i].on_board) bits |= CL_ON_BOARD;
+		cell_class[i] = bits;
+
+		bits = 0;
+		FOR_ADJ (i, j, k)
+		if (j >= 0 && j < MAP_SIZE && game->map[j].on_board)
+			bits |= 1 << k;
+		adj_mask[i] = bits;
+	}
+	for (i = 0; i < MAP_SIZE; i++) {
+		water = FALSE;
+		all_water = TRUE;
+		FOR_ADJ_ON (i, j, k) {
+			if (game->map[j].contents == '.') water = TRUE;
+			else all_water = FALSE;
+		}
+		if (water) cell_class[i] |= CL_SHORE;
+		if (all_water) cell_class[i] |= CL_AT_SEA;
+	}
+}
+
 /*
 When we run out of available land, we recreate our land list.  We
 put all land in the list, decrement the min_city_dist, and then
@@ -210,8 +688,10 @@ long placed;
 
 	num_land = 0;
 	for (i = 0; i < MAP_SIZE; i++) {
-		if (map[i].on_board && map[i].contents == '+') {
-			land[num_land] = i; /* remember piece of land */
+		if (game->map[i].on_board && game->map[i].contents == '+') {
+			game->land[num_land] = i; /* remember piece of land */
+			land_row[num_land] = loc_row (i);
+			land_col[num_land] = loc_col (i);
 			num_land++; /* remember number of pieces */
 		}
 	}
@@ -220,13 +700,15 @@ long placed;
 		ASSERT (MIN_CITY_DIST >= 0);
 	}
 	for (i = 0; i < placed; i++) { /* for each placed city */
-		num_land = remove_land (city[i].loc, num_land);
+		num_land = remove_land (game->city[i].loc, num_land);
 	}
 	return (num_land);
 }
 
 /*
-Remove land that is too close to a city.
+Remove land that is too close to a city.  The distances to the whole
+list are found at once by dist_list, which is why the row and column
+of each cell of land are kept beside it.
 */
 
 long remove_land (loc, num_land)
@@ -234,10 +716,13 @@ long loc, num_land;
 {
 	long new, i;
 
+	dist_list (loc, land_row, land_col, num_land, land_dist);
 	new = 0; /* nothing kept yet */
 	for (i = 0; i < num_land; i++) {
-		if (dist (loc, land[i]) >= MIN_CITY_DIST) {
-			land[new] = land[i];
+		if (land_dist[i] >= MIN_CITY_DIST) {
+			game->land[new] = game->land[i];
+			land_row[new] = land_row[i];
+			land_col[new] = land_col[i];
 			new++;
 		}
 	}
@@ -274,25 +759,10 @@ on a continent for each player.  We now choose a random city on each continent,
 making sure the cities are not the same.
 */
 
-#define MAX_CONT 10 /* most continents we will allow */
-
-typedef struct cont { /* a continent */
-	long value; /* value of continent */
-	int ncity; /* number of cities */
-	city_info_t * cityp[NUM_CITY]; /* pointer to city */
-} cont_t;
-
-typedef struct pair {
-	long value; /* value of pair for user */
-	int user_cont; /* index to user continent */
-	int comp_cont; /* index to computer continent */
-} pair_t;
-
-static int marked[MAP_SIZE]; /* list of examine cells */
-static int ncont; /* number of continents */
-static cont_t cont_tab[MAX_CONT]; /* list of good continenets */
-static int rank_tab[MAX_CONT]; /* indices to cont_tab in order of rank */
-static pair_t pair_tab[MAX_CONT*MAX_CONT]; /* ranked pairs of continents */
+#define ncont (game->ncont) /* number of continents */
+#define cont_tab (game->cont_tab) /* list of good continenets */
+#define rank_tab (game->rank_tab) /* indices to cont_tab in order of rank */
+#define pair_tab (game->pair_tab) /* ranked pairs of continents */
 
 int select_cities () {
 	void find_cont(), make_pair();
@@ -311,7 +781,9 @@ int select_cities () {
 		"Choose a difficulty level where 0 is easy and %d is hard: ",
 		ncont*ncont-1);
 
-	pair = get_range (jnkbuf, 0, ncont*ncont-1);
+	if (batch_turns) /* nobody to ask */
+		pair = batch_level < ncont*ncont ? batch_level : ncont*ncont-1;
+	else pair = get_range (jnkbuf, 0, ncont*ncont-1);
 	comp_cont = pair_tab[pair].comp_cont;
 	user_cont = pair_tab[pair].user_cont;
 
@@ -327,15 +799,15 @@ int select_cities () {
 	delay (); /* let user see output before we set_prod */
 
 	/* update city and map */
-	compp->owner = COMP;
+	set_city_owner (compp, COMP);
 	compp->prod = ARMY;
 	compp->work = 0;
 	scan (comp_map, compp->loc);
 
-	userp->owner = USER;
+	set_city_owner (userp, USER);
 	userp->work = 0;
 	scan (user_map, userp->loc);
-	set_prod (userp);
+	if (!batch_turns) set_prod (userp);
 	return (TRUE);
 }
 
@@ -348,7 +820,7 @@ void find_cont () {
 	long i;
 	long mapi;
 
-	for (i = 0; i < MAP_SIZE; i++) marked[i] = 0; /* nothing marked yet */
+	for (i = 0; i < MAP_SIZE; i++) game->marked[i] = 0; /* nothing marked yet */
 
 	ncont = 0; /* no continents found yet */
 	mapi = 0;
@@ -370,8 +842,8 @@ long *mapi;
 	for (;;) {
 		if (*mapi >= MAP_SIZE) return (FALSE);
 
-		if (!map[*mapi].on_board || marked[*mapi]
-			|| map[*mapi].contents == '.') *mapi += 1;
+		if (!game->map[*mapi].on_board || game->marked[*mapi]
+			|| game->map[*mapi].contents == '.') *mapi += 1;
 		else if (good_cont (*mapi)) {
 			rank_tab[ncont] = ncont; /* insert cont in rank tab */
 			val = cont_tab[ncont].value;
@@ -429,32 +901,56 @@ long mapi;
 }
 
 /*
-Mark a continent.  This recursive algorithm marks the current square
-and counts it if it is land or city.  If it is city, we also check
-to see if it is a shore city, and we install it in the list of
-cities for the continent.  We then examine each surrounding cell.
+Mark a continent.  We mark the current square and count it if it is
+land or city.  If it is city, we also check to see if it is a shore
+city, and we install it in the list of cities for the continent.  We
+then examine each surrounding cell.
+
+A continent on a large map is too big to walk recursively, so we keep
+our own stack in 'flood'.  Each entry holds a cell and the next
+direction to look from it, as loc*8+dir, and cells are visited in the
+same order the recursion would visit them, so the cities of each
+continent are listed in the same order.
 */
 
-static void
-mark_cont (mapi)
+static int
+mark_cell (mapi)
 long mapi;
 {
-	int i;
-
-	if (marked[mapi] || map[mapi].contents == '.'
-		|| !map[mapi].on_board) return;
+	if (game->marked[mapi] || game->map[mapi].contents == '.'
+		|| !game->map[mapi].on_board) return (FALSE);
 
-	marked[mapi] = 1; /* mark this cell seen */
+	game->marked[mapi] = 1; /* mark this cell seen */
 	nland++; /* count land on continent */
 
-	if (map[mapi].contents == '*') { /* a city? */
-		cont_tab[ncont].cityp[ncity] = map[mapi].cityp;
+	if (game->map[mapi].contents == '*') { /* a city? */
+		cont_tab[ncont].cityp[ncity] = CITY(game->map[mapi].cityp);
 		ncity++;
 		if (rmap_shore (mapi)) nshore++;
 	}
+	return (TRUE);
+}
 
-	for (i = 0; i < 8; i++) /* look at surrounding squares */
-		mark_cont (mapi + dir_offset[i]);
+static void
+mark_cont (mapi)
+long mapi;
+{
+	long top, loc;
+	int i;
+
+	if (!mark_cell (mapi)) return;
+	game->flood[0] = mapi * 8;
+	top = 1;
+
+	while (top > 0) {
+		loc = game->flood[top-1] / 8;
+		i = game->flood[top-1] % 8;
+		if (i == 7) top--; /* last direction from this cell */
+		else game->flood[top-1]++;
+
+		if (mark_cell (loc + dir_offset[i]))
+			game->flood[top++] = (loc + dir_offset[i]) * 8;
+	}
 }
 
 /*
@@ -498,33 +994,51 @@ tell the user why.
 /* macro to save typing; write an array, return if it fails */
 #define wbuf(buf) if (!xwrite (f, (char *)buf, sizeof (buf))) return
 #define wval(val) if (!xwrite (f, (char *)&val, sizeof (val))) return
+#define wcells(buf) if (!xwrite (f, (char *)buf, MAP_SIZE * sizeof (*buf))) return
 
 void save_game () {
 	FILE *f; /* file to save game in */
+	long start, span;
+	int i;
 
+	start = phase_begin ();
+	span = trace_begin ();
 	f = fopen ("empsave.dat", "w"); /* open for output */
 	if (f == NULL) {
 		perror ("Cannot save empsave.dat");
 		return;
 	}
-	wbuf (map);
-	wbuf (comp_map);
-	wbuf (user_map);
-	wbuf (city);
-	wbuf (object);
+	wval (MAP_WIDTH);
+	wval (MAP_HEIGHT);
+	wcells (game->map);
+	wcells (comp_map);
+	wcells (user_map);
+	wcells (comp_seen);
+	wcells (user_seen);
+	wval (NUM_CITY);
+	if (!xwrite (f, (char *)game->city, NUM_CITY * sizeof (city_info_t))) return;
+	wval (pool_size);
+	for (i = 0; i < pool_size / POOL_CHUNK; i++) {
+		if (!xwrite (f, (char *)obj_chunk[i],
+				POOL_CHUNK * sizeof (piece_info_t))) return;
+		if (!xwrite (f, (char *)link_chunk[i],
+				POOL_CHUNK * sizeof (piece_links_t))) return;
+	}
 	wbuf (user_obj);
 	wbuf (comp_obj);
 	wval (free_list);
-	wval (date);
+	wval (game->date);
 	wval (automove);
 	wval (resigned);
-	wval (debug);
-	wval (win);
+	wval (game->debug);
+	wval (game->win);
 	wval (save_movie);
 	wval (user_score);
 	wval (comp_score);
 
 	(void) fclose (f);
+	phase_end (PH_SAVE, start);
+	trace_end ("save_game", span, "date", game->date, NULL, 0);
 	topmsg (3, "Game saved.",0,0,0,0,0,0,0,0);
 }
 
@@ -535,81 +1049,124 @@ We return TRUE if we succeed, otherwise FALSE.
 
 #define rbuf(buf) if (!xread (f, (char *)buf, sizeof(buf))) return (FALSE);
 #define rval(val) if (!xread (f, (char *)&val, sizeof(val))) return (FALSE);
+#define rcells(buf) if (!xread (f, (char *)buf, MAP_SIZE * sizeof(*buf))) return (FALSE);
+
+/* TRUE if a reference from the save file is not in the object pool */
+#define BAD_REF(r) ((r) < 0 || (r) > pool_size)
 
 int restore_game () {
-	void read_embark();
+	void inconsistent();
 	
 	FILE *f; /* file to save game in */
 	long i;
-	piece_info_t **list;
 	piece_info_t *obj;
+	piece_links_t *lp;
+	int ncols, nrows; /* size of saved map */
+	int ncities;
 
 	f = fopen ("empsave.dat", "r"); /* open for input */
 	if (f == NULL) {
 		perror ("Cannot open empsave.dat");
 		return (FALSE);
 	}
-	rbuf (map);
-	rbuf (comp_map);
-	rbuf (user_map);
-	rbuf (city);
-	rbuf (object);
+	rval (ncols);
+	rval (nrows);
+	if (ncols < MIN_MAP_WIDTH || ncols > MAX_MAP_WIDTH
+	 || nrows < MIN_MAP_HEIGHT || nrows > MAX_MAP_HEIGHT)
+		inconsistent ();
+	if (!set_map_size (ncols, nrows)) {
+		perror ("Cannot restore empsave.dat");
+		(void) fclose (f);
+		return (FALSE);
+	}
+	rcells (game->map);
+	classify_map ();
+	rcells (comp_map);
+	rcells (user_map);
+	rcells (comp_seen);
+	rcells (user_seen);
+	rval (ncities);
+	if (ncities < MIN_NUM_CITY || ncities > MAX_NUM_CITY
+	 || ncities > MAP_SIZE / CELLS_PER_CITY)
+		inconsistent ();
+	if (!set_city_count (ncities)) {
+		perror ("Cannot restore empsave.dat");
+		(void) fclose (f);
+		return (FALSE);
+	}
+	if (!xread (f, (char *)game->city, NUM_CITY * sizeof (city_info_t))) return (FALSE);
+	rval (pool_size);
+	if (pool_size < 0 || pool_size % POOL_CHUNK != 0) inconsistent ();
+	if (!pool_reserve (pool_size)) {
+		perror ("Cannot restore empsave.dat");
+		(void) fclose (f);
+		return (FALSE);
+	}
+	for (i = 0; i < pool_size / POOL_CHUNK; i++) {
+		if (!xread (f, (char *)obj_chunk[i],
+				POOL_CHUNK * sizeof (piece_info_t))) return (FALSE);
+		if (!xread (f, (char *)link_chunk[i],
+				POOL_CHUNK * sizeof (piece_links_t))) return (FALSE);
+	}
 	rbuf (user_obj);
 	rbuf (comp_obj);
 	rval (free_list);
-	rval (date);
+	rval (game->date);
 	rval (automove);
 	rval (resigned);
-	rval (debug);
-	rval (win);
+	rval (game->debug);
+	rval (game->win);
 	rval (save_movie);
 	rval (user_score);
 	rval (comp_score);
 
-	/* Our pointers may not be valid because of source
-	changes or other things.  We recreate them. */
+	/* Pieces and cities refer to each other by number, so the lists
+	are good as they were saved.  We only check that every reference
+	is in range and that each live piece is on the board, and rebuild
+	the dense index and the sector lists. */
 	
-	free_list = NULL; /* zero all ptrs */
-	for (i = 0; i < MAP_SIZE; i++) {
-		map[i].cityp = NULL;
-		map[i].objp = NULL;
-	}
-	for (i = 0; i < LIST_SIZE; i++) {
-		object[i].loc_link.next = NULL;
-		object[i].loc_link.prev = NULL;
-		object[i].cargo_link.next = NULL;
-		object[i].cargo_link.prev = NULL;
-		object[i].piece_link.next = NULL;
-		object[i].piece_link.prev = NULL;
-		object[i].ship = NULL;
-		object[i].cargo = NULL;
-	}
-	for (i = 0; i < NUM_OBJECTS; i++) {
-		comp_obj[i] = NULL;
-		user_obj[i] = NULL;
-	}
-	/* put cities on map */
+	if (BAD_REF (free_list)) inconsistent ();
+	for (i = 0; i < NUM_OBJECTS; i++)
+		if (BAD_REF (user_obj[i]) || BAD_REF (comp_obj[i]))
+			inconsistent ();
+	for (i = 0; i < MAP_SIZE; i++)
+		if (BAD_REF (game->map[i].objp)
+		 || game->map[i].cityp < 0 || game->map[i].cityp > NUM_CITY)
+			inconsistent ();
 	for (i = 0; i < NUM_CITY; i++)
-		map[city[i].loc].cityp = &(city[i]);
-	
-	/* put pieces in free list or on map and in object lists */
-	for (i = 0; i < LIST_SIZE; i++) {
-		obj = &(object[i]);
-		if (object[i].owner == UNOWNED || object[i].hits == 0) {
-			LINK (free_list, obj, piece_link);
-		}
-		else {
-			list = LIST (object[i].owner);
-			LINK (list[object[i].type], obj, piece_link);
-			LINK (map[object[i].loc].objp, obj, loc_link);
-		}
+		if (game->city[i].owner >= NUM_OWNERS
+		 || game->city[i].loc < 0 || game->city[i].loc >= MAP_SIZE
+		 || game->map[game->city[i].loc].cityp != i + 1)
+			inconsistent ();
+	city_grid_reset ();
+
+	for (i = 0; i <= NUM_GROUPS; i++)
+		vec_start[i] = 0; /* empty index */
+	prod_plan = NULL; /* plans are not saved */
+	obj_used = 0;
+	for (i = 0; i < pool_size; i++) {
+		obj = POOL_OBJ (i);
+		obj->ref = i + 1;
+		lp = LINKS (obj);
+		if (BAD_REF (lp->piece_link.next) || BAD_REF (lp->piece_link.prev)
+		 || BAD_REF (lp->loc_link.next) || BAD_REF (lp->loc_link.prev)
+		 || BAD_REF (lp->cargo_link.next) || BAD_REF (lp->cargo_link.prev)
+		 || BAD_REF (lp->ship) || BAD_REF (lp->cargo))
+			inconsistent ();
+		if (obj->hits == 0) continue; /* free */
+
+		if (obj->owner != USER && obj->owner != COMP
+		 || obj->type < 0 || obj->type >= NUM_OBJECTS
+		 || obj->loc < 0 || obj->loc >= MAP_SIZE
+		 || !game->map[obj->loc].on_board)
+			inconsistent ();
+		obj_used += 1;
+		vec_add (obj);
 	}
-	
-	/* Embark armies and fighters. */
-	read_embark (user_obj[TRANSPORT], ARMY);
-	read_embark (user_obj[CARRIER], FIGHTER);
-	read_embark (comp_obj[TRANSPORT], ARMY);
-	read_embark (comp_obj[CARRIER], FIGHTER);
+	sector_reset ();
+	obj_high = obj_used; /* no history before the save */
+	hash_reset ();
+	all_changed (); /* we don't know what the players have seen */
 	
 	(void) fclose (f);
 	kill_display (); /* what we had is no longer good */
@@ -618,36 +1175,9 @@ int restore_game () {
 }
 	
 /*
-Embark cargo on a ship.  We loop through the list of ships.
-We then loop through the pieces at the ship's location until
-the ship has the same amount of cargo it previously had.
+The save file does not describe a game we can play.
 */
 
-void read_embark (list, piece_type)
-piece_info_t *list;
-int piece_type;
-{
-	void inconsistent();
-
-	piece_info_t *ship;
-	piece_info_t *obj;
-	int count;
-
-	for (ship = list; ship != NULL; ship = ship->piece_link.next) {
-		count = ship->count; /* get # of pieces we need */
-		if (count < 0) inconsistent ();
-		ship->count = 0; /* nothing on board yet */
-		for (obj = map[ship->loc].objp; obj && count;
-		    obj = obj->loc_link.next) {
-			if (obj->ship == NULL && obj->type == piece_type) {
-				embark (ship, obj);
-				count -= 1;
-			}
-		}
-		if (count) inconsistent ();
-	}
-}
-
 void inconsistent () {
 	(void) printf ("empsave.dat is inconsistent.  Please remove it.\n");
 	exit (1);
@@ -708,7 +1238,7 @@ computer's screen.  This information is appended to 'empmovie.dat'.
 */
 
 extern char city_char[];
-static char mapbuf[MAP_SIZE];
+#define mapbuf (game->mapbuf)
 
 void
 save_movie_screen ()
@@ -716,7 +1246,10 @@ save_movie_screen ()
 	FILE *f; /* file to save game in */
 	long i;
 	piece_info_t *p;
+	long start, span;
 
+	start = phase_begin ();
+	span = trace_begin ();
 	f = fopen ("empmovie.dat", "a"); /* open for append */
 	if (f == NULL) {
 		perror ("Cannot open empmovie.dat");
@@ -724,23 +1257,29 @@ save_movie_screen ()
 	}
 
 	for (i = 0; i < MAP_SIZE; i++) {
-		if (map[i].cityp) mapbuf[i] = city_char[map[i].cityp->owner];
+		if (game->map[i].cityp) mapbuf[i] = city_char[CITY(game->map[i].cityp)->owner];
 		else {
 			p = find_obj_at_loc (i);
 			
-			if (!p) mapbuf[i] = map[i].contents;
+			if (!p) mapbuf[i] = game->map[i].contents;
 			else if (p->owner == USER)
 				mapbuf[i] = piece_attr[p->type].sname;
 			else mapbuf[i] = tolower (piece_attr[p->type].sname);
 		}
 	}
-	wbuf (mapbuf);
+	wval (MAP_WIDTH); /* each frame says how big it is */
+	wval (MAP_HEIGHT);
+	wcells (mapbuf);
 	(void) fclose (f);
+	phase_end (PH_MOVIE, start);
+	trace_end ("save_movie", span, "date", game->date, NULL, 0);
 }
 
 /*
 Replay a movie.  We read each buffer from the file and
-print it using a zoomed display.
+print it using a zoomed display.  The file is added to by every game
+that saves a movie, so we skip frames of a map of another size, and
+stop at anything that does not look like a frame.
 */
 
 void
@@ -752,8 +1291,8 @@ replay_movie ()
 	int row_inc, col_inc;
 	int r, c;
 	int round;
+	int ncols, nrows; /* size of the map in a frame */
 
-	
 	f = fopen ("empmovie.dat", "r"); /* open for input */
 	if (f == NULL) {
 		perror ("Cannot open empmovie.dat");
@@ -762,7 +1301,16 @@ replay_movie ()
 	round = 0;
 	clear_screen ();
 	for (;;) {
-		if (fread ((char *)mapbuf, 1, sizeof (mapbuf), f) != sizeof (mapbuf)) break;
+		if (fread ((char *)&ncols, sizeof (ncols), 1, f) != 1
+		 || fread ((char *)&nrows, sizeof (nrows), 1, f) != 1
+		 || ncols < MIN_MAP_WIDTH || ncols > MAX_MAP_WIDTH
+		 || nrows < MIN_MAP_HEIGHT || nrows > MAX_MAP_HEIGHT)
+			break;
+		if (ncols != MAP_WIDTH || nrows != MAP_HEIGHT) { /* not ours */
+			if (fseek (f, (long)ncols * nrows, SEEK_CUR) != 0) break;
+			continue;
+		}
+		if (fread ((char *)mapbuf, 1, MAP_SIZE, f) != MAP_SIZE) break;
 		round += 1;
 		
 		stat_display (mapbuf, round);
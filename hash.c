@@ -0,0 +1,150 @@
+/* %W% %G% %U% - (c) Copyright 1987, 1988 Chuck Simmons */
+
+/*
+ *    Copyright (C) 1987, 1988 Chuck Simmons
+ *
+ * See the file COPYING, distributed with empire, for restriction
+ * and warranty information.
+ */
+
+/*
+hash.c -- keep a 64 bit hash of the state of a game.
+
+Two games that hash the same are, for all practical purposes, the
+same game.  Printing the hash after every turn of a seeded batch game
+('empire -b turns -r seed -z') lets us check that a change to the
+engine has not changed how the game plays, and the hash can be used
+to spot duplicate snapshots.
+
+The hash is the exclusive-or of a key for each live piece, a key
+for each city, and a key for each cell of the map.  A piece's key
+mixes its number in the object pool with its type, owner, location,
+hits, function, and the ship it is on.  Because exclusive-or is its
+own inverse, a piece is taken out of the hash by hashing it again,
+so 'piece_hash' is kept up to date as we go: the routines that change
+a piece call 'hash_piece' once before the change and once after.
+
+The map's terrain does not change during play, so its part of the
+hash is computed once when the game is made or restored.  There are
+only a few cities and they change in many places, so their part is
+recomputed whenever 'state_hash' is called.
+*/
+
+#include "empire.h"
+#include "extern.h"
+
+#define CITY_SALT 0x5ca1ab1e00000000ULL /* keep city keys apart from pieces */
+#define MAP_SALT 0x0dd5eed000000000ULL
+
+/*
+Scramble the bits of a value (the finalizer from splitmix64).
+*/
+
+static hash_t
+mix (h)
+hash_t h;
+{
+	h ^= h >> 30;
+	h *= 0xbf58476d1ce4e5b9ULL;
+	h ^= h >> 27;
+	h *= 0x94d049bb133111ebULL;
+	h ^= h >> 31;
+	return h;
+}
+
+/*
+Return the key of a piece.
+*/
+
+static hash_t
+piece_key (obj)
+piece_info_t *obj;
+{
+	hash_t h;
+
+	h = mix ((hash_t)obj->ref);
+	h = mix (h ^ (hash_t)obj->type ^ (hash_t)obj->owner << 8
+		^ (hash_t)(unsigned short)obj->hits << 16
+		^ (hash_t)LINKS(obj)->ship << 32);
+	h = mix (h ^ (hash_t)(unsigned long)obj->loc
+		^ (hash_t)(unsigned long)obj->func << 32);
+	return h;
+}
+
+/*
+Put a piece into the hash, or take it out again.
+*/
+
+void
+hash_piece (obj)
+piece_info_t *obj;
+{
+	game->piece_hash ^= piece_key (obj);
+	if (checking) touch_piece (obj); /* see check_recent */
+}
+
+/*
+Set the function of a piece.
+*/
+
+void
+set_func (obj, func)
+piece_info_t *obj;
+long func;
+{
+	hash_piece (obj);
+	obj->func = func;
+	hash_piece (obj);
+}
+
+/*
+Hash the live pieces from scratch.
+*/
+
+hash_t
+hash_pieces ()
+{
+	hash_t h;
+	long i;
+
+	h = 0;
+	for (i = 0; i < pool_size; i++)
+		if (POOL_OBJ (i)->hits > 0) h ^= piece_key (POOL_OBJ (i));
+	return h;
+}
+
+/*
+Compute the hash of the whole game from scratch.  This is done when
+a game is made or restored.
+*/
+
+void
+hash_reset ()
+{
+	long i;
+	hash_t h;
+
+	h = 0;
+	for (i = 0; i < MAP_SIZE; i++)
+		h ^= mix (MAP_SALT ^ (hash_t)i << 8 ^ (hash_t)game->map[i].contents);
+	game->map_hash = h;
+	game->piece_hash = hash_pieces ();
+}
+
+/*
+Return the hash of the current game.
+*/
+
+hash_t
+state_hash ()
+{
+	hash_t h;
+	int i;
+
+	h = game->map_hash ^ game->piece_hash ^ mix ((hash_t)game->date);
+	for (i = 0; i < NUM_CITY; i++)
+		h ^= mix (CITY_SALT ^ (hash_t)i << 16 ^ (hash_t)game->city[i].owner
+			^ (hash_t)(unsigned char)game->city[i].prod << 8
+			^ (hash_t)(unsigned long)game->city[i].work << 32);
+	return h;
+}
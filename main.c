@@ -17,19 +17,54 @@ options:
 	      
     -s smooth: amount of smoothing performed to generate map.  Must
 	       be a nonnegative integer.  Default is 5.
+
+    -W width:  width of the map.  Must be in the range 40..2000.
+	       Default is 100.
+
+    -H height: height of the map.  Must be in the range 24..2000.
+	       Default is 60.
+
+    -c cities: number of cities.  Must be in the range 10..5000, with
+	       at least 40 cells of map for each city.  Default is 70.
 	       
     -d delay:  number of milliseconds to delay between output.
                default is 2000 (2 seconds).
 
     -S saveinterval: sets turn interval between saves.
 	       default is 10
+
+    -t file:   record a timeline of each turn in 'file', in Chrome
+	       trace-event format, when the game ends.
+
+    -b turns:  play without a display.  The computer plays alone for
+	       the given number of turns, and the outcome is printed.
+
+    -m:        with -b, also print a report of the memory used.
+
+    -r seed:   with -b, start the random numbers from the given seed
+	       (a positive integer) so that a game can be replayed.
+
+    -l level:  with -b, the difficulty level to play.  Default is 0.
+
+    -z:        with -b, print a hash of the game after every turn.
+	       Two runs with the same seed should print the same hashes.
+
+    -a turns:  every ten turns, let the computer choose its production
+	       ratios by playing each candidate the given number of turns
+	       ahead.  Default is 0, which keeps the usual ratios.
+
+    -k interval: check the game for consistency as it is played.  The
+	       pieces and cells that change are checked as pieces move,
+	       and everything is checked every interval turns (never, if
+	       interval is 0).  Problems are written to 'empcheck.dat'.
+	       Programs built with -DDEBUG check as if given -k 1.
 */
 
 #include <stdio.h>
 #include "empire.h"
 #include "extern.h"
 
-#define OPTFLAGS "w:s:d:S:"
+#define OPTFLAGS "w:s:W:H:c:d:S:t:b:mr:l:za:k:"
 
 main (argc, argv)
 int argc;
@@ -40,13 +75,31 @@ char *argv[];
 	extern int optind;
 	extern int opterr;      /* set to 1 to suppress error msg */
 	int errflg = 0;
-	int wflg, sflg, dflg, Sflg;
+	int wflg, sflg, Wflg, Hflg, cflg, dflg, Sflg, bflg, mflg, lflg, zflg, aflg;
+	int kflg;
+	long rflg;
+	char *tflg;
 	int land;
 	
 	wflg = 70; /* set defaults */
 	sflg = 5;
+	Wflg = DEF_MAP_WIDTH;
+	Hflg = DEF_MAP_HEIGHT;
+	cflg = DEF_NUM_CITY;
 	dflg = 2000;
 	Sflg = 10;
+	tflg = NULL;
+	bflg = 0;
+	mflg = FALSE;
+	rflg = 0;
+	lflg = 0;
+	zflg = FALSE;
+	aflg = 0;
+#ifdef DEBUG
+	kflg = 1; /* check everything every turn */
+#else
+	kflg = -1; /* no checking */
+#endif
 
 	/*
 	 * extract command line options
@@ -60,19 +113,53 @@ char *argv[];
 		case 's':
 			sflg = atoi (optarg);
 			break;
+		case 'W':
+			Wflg = atoi (optarg);
+			break;
+		case 'H':
+			Hflg = atoi (optarg);
+			break;
+		case 'c':
+			cflg = atoi (optarg);
+			break;
 		case 'd':
 			dflg = atoi (optarg);
 			break;
 		case 'S':
 			Sflg = atoi (optarg);
 			break;
+		case 't':
+			tflg = optarg;
+			break;
+		case 'b':
+			bflg = atoi (optarg);
+			break;
+		case 'm':
+			mflg = TRUE;
+			break;
+		case 'r':
+			rflg = atol (optarg);
+			break;
+		case 'l':
+			lflg = atoi (optarg);
+			break;
+		case 'z':
+			zflg = TRUE;
+			break;
+		case 'a':
+			aflg = atoi (optarg);
+			break;
+		case 'k':
+			kflg = atoi (optarg);
+			if (kflg < 0) errflg++;
+			break;
 		case '?': /* illegal option? */
 			errflg++;
 			break;
 		}
 	}
 	if (errflg || (argc-optind) != 0) {
-		(void) printf ("empire: usage: empire [-w water] [-s smooth] [-d delay]\n");
+		(void) printf ("empire: usage: empire [-w water] [-s smooth] [-W width] [-H height] [-c cities] [-d delay] [-S interval] [-t file] [-a turns] [-k interval] [-b turns [-m] [-r seed] [-l level] [-z]]\n");
 		exit (1);
 	}
 
@@ -84,16 +171,60 @@ char *argv[];
 		(void) printf ("empire: -s argument must be greater or equal to zero.\n");
 		exit (1);
 	}
+	if (Wflg < MIN_MAP_WIDTH || Wflg > MAX_MAP_WIDTH) {
+		(void) printf ("empire: -W argument must be in the range %d..%d.\n",
+			MIN_MAP_WIDTH, MAX_MAP_WIDTH);
+		exit (1);
+	}
+	if (Hflg < MIN_MAP_HEIGHT || Hflg > MAX_MAP_HEIGHT) {
+		(void) printf ("empire: -H argument must be in the range %d..%d.\n",
+			MIN_MAP_HEIGHT, MAX_MAP_HEIGHT);
+		exit (1);
+	}
+	if (cflg < MIN_NUM_CITY || cflg > MAX_NUM_CITY
+	 || cflg > Wflg * Hflg / CELLS_PER_CITY) {
+		(void) printf ("empire: -c argument must be in the range %d..%d, and at most %d for this map.\n",
+			MIN_NUM_CITY, MAX_NUM_CITY, Wflg * Hflg / CELLS_PER_CITY);
+		exit (1);
+	}
 	
 	if (dflg < 0 || dflg > 30000) {
 		(void) printf ("empire: -d argument must be in the range 0..30000.\n");
 		exit (1);
 	}
+	if (bflg < 0) {
+		(void) printf ("empire: -b argument must be greater or equal to zero.\n");
+		exit (1);
+	}
+	if ((mflg || rflg || lflg || zflg) && bflg == 0) {
+		(void) printf ("empire: -m, -r, -l and -z require -b.\n");
+		exit (1);
+	}
+	if (rflg < 0 || lflg < 0 || aflg < 0) {
+		(void) printf ("empire: -r, -l and -a arguments must be positive.\n");
+		exit (1);
+	}
 
+	game = alloc_game ();
+	if (game == NULL || !set_map_size (Wflg, Hflg)
+	 || !set_city_count (cflg)) {
+		(void) printf ("empire: not enough memory for a game.\n");
+		exit (1);
+	}
 	SMOOTH = sflg;
 	WATER_RATIO = wflg;
 	delay_time = dflg;
 	save_interval = Sflg;
+	batch_turns = bflg;
+	batch_memory = mflg;
+	batch_seed = rflg;
+	batch_level = lflg;
+	batch_hash = zflg;
+	plan_horizon = aflg;
+	checking = kflg >= 0;
+	check_interval = kflg > 0 ? kflg : 0;
+	if (bflg) delay_time = 0; /* nobody to read messages */
+	if (tflg) trace_open (tflg);
 
 	/* compute min distance between cities */
 	land = MAP_SIZE * (100 - WATER_RATIO) / 100; /* available land */
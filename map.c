@@ -43,13 +43,13 @@ STATIC void start_perimeter(path_map_t *pmap,perimeter_t *perim,long loc,int ter
 STATIC void add_cell(path_map_t *pmap,long new_loc,perimeter_t *perim,int terrain,int cur_cost,int inc_cost);
 STATIC int vmap_count_path (path_map_t *pmap,long loc);
 
-static perimeter_t p1; /* perimeter list for use as needed */
-static perimeter_t p2;
-static perimeter_t p3;
-static perimeter_t p4;
+#define p1 (game->p1) /* perimeter list for use as needed */
+#define p2 (game->p2)
+#define p3 (game->p3)
+#define p4 (game->p4)
 
-static int best_cost; /* cost and location of best objective */
-static long best_loc;
+#define best_cost (game->best_cost) /* cost and location of best objective */
+#define best_loc (game->best_loc)
 
 /*
 Map out a continent.  We are given a location on the continent.
@@ -88,6 +88,7 @@ char bad_terrain;
 	char this_terrain;
 	perimeter_t *from, *to;
 
+	stack_probe ();
 	from = &p1;
 	to = &p2;
 	
@@ -97,6 +98,7 @@ char bad_terrain;
 	
 	while (from->len) {
 		to->len = 0; /* nothing in new perimeter yet */
+		expand_count += from->len;
 		
 		for (i = 0; i < from->len; i++) /* expand perimeter */
 		FOR_ADJ_ON(from->list[i], new_loc, j)
@@ -107,7 +109,7 @@ char bad_terrain;
 			else {
 				if (vmap[new_loc].contents == '+') this_terrain = '+';
 				else if (vmap[new_loc].contents == '.') this_terrain = '.';
-				else this_terrain = map[new_loc].contents;
+				else this_terrain = game->map[new_loc].contents;
 				
 				if (this_terrain != bad_terrain) { /* on continent? */
 					cont_map[new_loc] = 1;
@@ -141,11 +143,9 @@ char bad_terrain;
 }
 
 /*
-Mark all squares of a continent and the squares that are adjacent
-to the continent which are on the board.  Our passed location is
-known to be either on the continent or adjacent to the continent.
-
-Someday this should be tweaked to use perimeter lists.
+Mark all squares of a continent.  Our passed location is known to be
+either on the continent or adjacent to the continent.  We grow the
+continent a perimeter at a time, as vmap_mark_up_cont does.
 */
 
 static void
@@ -154,17 +154,33 @@ int *cont_map;
 long loc;
 char bad_terrain;
 {
-	int i;
+	int i, j;
 	long new_loc;
-	
-	if (!map[loc].on_board) return; /* off board */
+	perimeter_t *from, *to;
+
+	if (!ON_BOARD (loc)) return; /* off board */
 	if (cont_map[loc]) return; /* already marked */
-	if (map[loc].contents == bad_terrain) return; /* off continent */
+	if (game->map[loc].contents == bad_terrain) return; /* off continent */
+
+	from = &p1;
+	to = &p2;
 	
+	from->len = 1; /* init perimeter */
+	from->list[0] = loc;
 	cont_map[loc] = 1; /* on continent */
 
-	FOR_ADJ (loc, new_loc, i)
-		rmap_mark_up_cont (cont_map, new_loc, bad_terrain);
+	while (from->len) {
+		to->len = 0; /* nothing in new perimeter yet */
+		
+		for (i = 0; i < from->len; i++) /* expand perimeter */
+		FOR_ADJ_ON (from->list[i], new_loc, j)
+		if (!cont_map[new_loc] && game->map[new_loc].contents != bad_terrain) {
+			cont_map[new_loc] = 1;
+			to->list[to->len] = new_loc;
+			to->len += 1;
+		}
+		SWAP (from, to);
+	}
 }
 
 /*
@@ -213,8 +229,8 @@ view_map_t *vmap;
 			case '+': break;
 			case '.': break;
 			default: /* check for city underneath */
-				if (map[i].contents == '*') {
-					switch (map[i].cityp->owner) {
+				if (game->map[i].contents == '*') {
+					switch (CITY(game->map[i].cityp)->owner) {
 					COUNT (USER, counts.user_cities);
 					COUNT (COMP, counts.comp_cities);
 					COUNT (UNOWNED, counts.unowned_cities);
@@ -243,7 +259,7 @@ int *cont_map;
 	for (i = 0; i < MAP_SIZE; i++) {
 		if (cont_map[i]) { /* cell on continent? */
 			counts.size += 1;
-			if (map[i].contents == '*')
+			if (game->map[i].contents == '*')
 				counts.unowned_cities += 1;
 		}
 	}
@@ -313,10 +329,13 @@ int expand;
 	perimeter_t *from;
 	perimeter_t *to;
 	int cur_cost;
+	long span;
 
 	from = &p1;
 	to = &p2;
 	
+	span = trace_begin ();
+	if (timing) stats_search (move_info);
 	start_perimeter (path_map, from, loc, start);
 	cur_cost = 0; /* cost to reach current perimeter */
 
@@ -329,8 +348,12 @@ int expand;
 			print_pzoom ("After xobj loop:", path_map, vmap);
 
 		cur_cost += 1;
-		if (to->len == 0 || best_cost <= cur_cost)
+		if (to->len == 0 || best_cost <= cur_cost) {
+			trace_end (expand == T_AIR ? "vmap_find_aobj"
+				: expand == T_WATER ? "vmap_find_wobj" : "vmap_find_lobj",
+				span, "loc", loc, "found", best_loc);
 			return best_loc;
+		}
 
 		SWAP (from, to);
 	}
@@ -397,12 +420,15 @@ int beat_cost;
 	perimeter_t *new_land;
 	perimeter_t *new_water;
 	int cur_cost;
+	long span;
 
 	cur_land = &p1;
 	cur_water = &p2;
 	new_water = &p3;
 	new_land = &p4;
 	
+	span = trace_begin ();
+	if (timing) stats_search (move_info);
 	start_perimeter (path_map, cur_land, loc, T_LAND);
 	cur_water->len = 0;
 	best_cost = beat_cost; /* we can do this well */
@@ -428,6 +454,7 @@ int beat_cost;
 		
 		cur_cost += 2;
 		if (cur_water->len == 0 && new_land->len == 0 || best_cost <= cur_cost) {
+			trace_end ("vmap_find_lwobj", span, "loc", loc, "found", best_loc);
 			return best_loc;
 		}
 
@@ -482,12 +509,15 @@ move_info_t *move_info;
 	perimeter_t *new_land;
 	perimeter_t *new_water;
 	int cur_cost;
+	long span;
 
 	cur_land = &p1;
 	cur_water = &p2;
 	new_water = &p3;
 	new_land = &p4;
 	
+	span = trace_begin ();
+	if (timing) stats_search (move_info);
 	start_perimeter (path_map, cur_water, loc, T_WATER);
 	cur_land->len = 0;
 	cur_cost = 0; /* cost to reach current perimeter */
@@ -512,6 +542,7 @@ move_info_t *move_info;
 		
 		cur_cost += 2;
 		if (cur_water->len == 0 && new_land->len == 0 || best_cost <= cur_cost) {
+			trace_end ("vmap_find_wlobj", span, "loc", loc, "found", best_loc);
 			return best_loc;
 		}
 		SWAP (cur_land, new_land);
@@ -522,13 +553,10 @@ move_info_t *move_info;
 Initialize the perimeter searching.
 
 This routine was taking a significant amount of the program time (10%)
-doing the initialization of the path map.  We now use an external
-constant and 'memcpy'.
+doing the initialization of the path map.  We now keep a blank path
+map, 'pmap_init', with the game and use 'memcpy'.
 */
 
-static path_map_t pmap_init[MAP_SIZE];
-static int init_done = 0;
-
 STATIC void
 start_perimeter (pmap, perim, loc, terrain)
 path_map_t *pmap;
@@ -536,17 +564,9 @@ perimeter_t *perim;
 long loc;
 int terrain;
 {
-	int i;
-	
 	/* zap the path map */
-	if (!init_done) {
-		init_done = 1;
-		for (i = 0; i < MAP_SIZE; i++) {
-			pmap_init[i].cost = INFINITY; /* everything lies outside perim */
-			pmap_init[i].terrain = T_UNKNOWN;
-		}
-	}
-	(void) memcpy ((char *)pmap, (char *)pmap_init, sizeof (pmap_init));
+	(void) memcpy ((char *)pmap, (char *)game->pmap_init,
+			MAP_SIZE * sizeof (path_map_t));
 	
 	/* put first location in perimeter */
 	pmap[loc].cost = 0;
@@ -594,6 +614,9 @@ perimeter_t *landp; /* pointer to new land perimeter */
 	int obj_cost;
 	register int new_type;
 
+	expand_count += curp->len;
+	if (timing) stats_perimeter (curp->len);
+	stack_probe ();
 	for (i = 0; i < curp->len; i++) /* for each perimeter cell... */
 	FOR_ADJ_ON (curp->list[i], new_loc, j) {/* for each adjacent cell... */
 		register path_map_t *pm = pmap + new_loc;
@@ -660,6 +683,7 @@ int base_cost;
 	city_info_t *cityp;
 
 	p = strchr (move_info->objectives, vmap[loc].contents);
+	if (timing) stats_objective (p != NULL);
 	if (!p) return INFINITY;
 
 	w = move_info->weights[p - move_info->objectives];
@@ -701,11 +725,11 @@ long to_loc;
 	if (vmap[to_loc].contents == '%') return T_UNKNOWN; /* magic objective */
 	if (vmap[to_loc].contents == ' ') return pmap[from_loc].terrain;
 	
-	switch (map[to_loc].contents) {
+	switch (game->map[to_loc].contents) {
 	case '.': return T_WATER;
 	case '+': return T_LAND;
 	case '*':
-		if (map[to_loc].cityp->owner == move_info->city_owner)
+		if (CITY(game->map[to_loc].cityp)->owner == move_info->city_owner)
 			return T_WATER;
 		else return T_UNKNOWN; /* cannot cross */
 	}
@@ -747,14 +771,16 @@ void
 vmap_prune_explore_locs (vmap)
 view_map_t *vmap;
 {
-	path_map_t pmap[MAP_SIZE];
+	path_map_t *pmap;
 	perimeter_t *from, *to;
 	int explored;
 	long loc, new_loc;
 	long i;
 	long copied;
 
-	(void) bzero (pmap, sizeof (pmap));
+	stack_enter (ST_PRUNE);
+	pmap = game->prune_pmap;
+	(void) bzero ((char *)pmap, MAP_SIZE * sizeof (path_map_t));
 	from = &p1;
 	to = &p2;
 	from->len = 0;
@@ -767,7 +793,7 @@ view_map_t *vmap;
 			FOR_ADJ (loc, new_loc, i) {
 				if (new_loc < 0 || new_loc >= MAP_SIZE); /* ignore off map */
 				else if (vmap[new_loc].contents == ' '); /* ignore adjacent unexplored */
-				else if (map[new_loc].contents != '.')
+				else if (game->map[new_loc].contents != '.')
 					pmap[loc].cost += 1; /* count land */
 				else pmap[loc].inc_cost += 1; /* count water */
 			}
@@ -884,6 +910,7 @@ int *explored;
 	long new_loc;
 	
 	*explored += 1;
+	expand_count += 1;
 	
 	if (type == T_LAND) vmap[loc].contents = '+';
 	else vmap[loc].contents = '.';
@@ -924,7 +951,9 @@ int terrain; /* terrain we can cross */
 	int start_terrain;
 	move_info_t move_info;
 	char old_contents;
+	long span;
 
+	span = trace_begin ();
 	old_contents = vmap[dest_loc].contents;
 	vmap[dest_loc].contents = '%'; /* mark objective */
 	move_info.city_owner = owner;
@@ -937,6 +966,7 @@ int terrain; /* terrain we can cross */
 	if (terrain == T_AIR) start_terrain = T_LAND;
 	else start_terrain = terrain;
 	
+	if (timing) stats_search (&move_info);
 	start_perimeter (path_map, from, cur_loc, start_terrain);
 	cur_cost = 0; /* cost to reach current perimeter */
 
@@ -947,6 +977,7 @@ int terrain; /* terrain we can cross */
 		cur_cost += 1;
 		if (to->len == 0 || best_cost <= cur_cost) {
 			vmap[dest_loc].contents = old_contents;
+			trace_end ("vmap_find_dest", span, "loc", cur_loc, "dest", dest_loc);
 			return best_loc;
 		}
 		SWAP (from, to);
@@ -954,7 +985,7 @@ int terrain; /* terrain we can cross */
 }
 
 /*
-Starting with the destination, we recursively back track toward the source
+Starting with the destination, we back track toward the source
 marking all cells which are on a shortest path between the start and the
 destination.  To do this, we know the distance from the destination to
 the start.  The destination is on a path.  We then find the cells adjacent
@@ -965,7 +996,9 @@ adjacent to P, the cost to reach S is less than the cost to reach P,
 and the cost to move from S to P is the difference in cost between
 S and P.
 
-Someday, this routine should probably use perimeter lists as well.
+We work back from the destination a perimeter at a time.  A cell is
+marked as it is added to the perimeter, so it is expanded only once.
+The start, whose cost is zero, is never marked.
 */
 
 void
@@ -975,18 +1008,38 @@ view_map_t *vmap;
 long dest;
 {
 	int n;
-	long new_dest;
+	long i, loc, new_loc;
+	perimeter_t *from, *to;
 
 	if (path_map[dest].cost == 0) return; /* reached end of path */
 	if (path_map[dest].terrain == T_PATH) return; /* already marked */
 
+	from = &p1;
+	to = &p2;
+
 	path_map[dest].terrain = T_PATH; /* this square is on path */
+	expand_count += 1;
+	from->len = 1;
+	from->list[0] = dest;
 
-	/* loop to mark adjacent squares on shortest path */
-	FOR_ADJ (dest, new_dest, n)
-	if (path_map[new_dest].cost == path_map[dest].cost - path_map[dest].inc_cost)
-			vmap_mark_path (path_map, vmap, new_dest);
+	while (from->len) {
+		to->len = 0;
 
+		/* mark adjacent squares on shortest path */
+		for (i = 0; i < from->len; i++) {
+			loc = from->list[i];
+			FOR_ADJ (loc, new_loc, n)
+			if (path_map[new_loc].cost == path_map[loc].cost - path_map[loc].inc_cost
+			 && path_map[new_loc].cost != 0
+			 && path_map[new_loc].terrain != T_PATH) {
+				path_map[new_loc].terrain = T_PATH;
+				expand_count += 1;
+				to->list[to->len] = new_loc;
+				to->len += 1;
+			}
+		}
+		SWAP (from, to);
+	}
 }
 
 /*
@@ -1165,12 +1218,7 @@ int
 rmap_shore (loc)
 long loc;
 {
-	long i, j;
-
-	FOR_ADJ_ON (loc, j, i)
-	if (map[j].contents == '.') return (TRUE);
-
-	return (FALSE);
+	return ((cell_class[loc] & CL_SHORE) != 0);
 }
 
 int
@@ -1180,8 +1228,10 @@ long loc;
 {
 	long i, j;
 
+	if (!(cell_class[loc] & CL_SHORE)) return (FALSE);
+
 	FOR_ADJ_ON (loc, j, i)
-	if (vmap[j].contents != ' ' && vmap[j].contents != '+' && map[j].contents == '.')
+	if (vmap[j].contents != ' ' && vmap[j].contents != '+' && (cell_class[j] & CL_WATER))
 			return (TRUE);
 
 	return (FALSE);
@@ -1199,8 +1249,10 @@ long loc;
 {
 	long i, j;
 
+	if (!(cell_class[loc] & CL_AT_SEA)) return (FALSE);
+
 	FOR_ADJ_ON (loc, j, i)
-	if (vmap[j].contents == ' ' || vmap[j].contents == '+' || map[j].contents != '.')
+	if (vmap[j].contents == ' ' || vmap[j].contents == '+')
 			return (FALSE);
 
 	return (TRUE);
@@ -1210,11 +1262,26 @@ int
 rmap_at_sea (loc)
 long loc;
 {
-	long i, j;
+	return ((cell_class[loc] & CL_AT_SEA) != 0);
+}
 
-	FOR_ADJ_ON (loc, j, i) {
-		if (map[j].contents != '.') return (FALSE);
+/*
+Return the cell classes of the terrain characters in 'terrain',
+such as ".+*".
+*/
+
+int
+terrain_class (terrain)
+char *terrain;
+{
+	int bits;
+
+	bits = 0;
+	for (; *terrain; terrain++) {
+		if (*terrain == '+') bits |= CL_LAND;
+		else if (*terrain == '.') bits |= CL_WATER;
+		else if (*terrain == '*') bits |= CL_CITY;
 	}
-	return (TRUE);
+	return (bits);
 }
 
@@ -17,9 +17,15 @@ The flavors of random integers that can be generated are:
     irand(n) -- returns a random integer in the range 0..n-1
     rndint(a,b) -- returns a random integer in the range a..b
 
+Each game has its own random sequence, so that games sharing a process
+do not disturb each other.  We use the simple generator given in the C
+standard, which gives the same sequence everywhere.
+
 Other routines include:
 
     dist (a, b) -- returns the straight-line distance between two locations.
+    dist_list (loc, rows, cols, n, d) -- the distance from 'loc' to
+	each of a list of locations.
 */
 
 #include "empire.h"
@@ -27,7 +33,23 @@ Other routines include:
 
 void rndini()
 {
-	srand((unsigned)(time(0) & 0xFFFF));
+	game->rng = (unsigned long)(time(0) & 0xFFFF);
+}
+
+/* Start the game's sequence from a given seed, to replay a game. */
+
+void rndset(seed)
+long seed;
+{
+	game->rng = (unsigned long)seed & 0xFFFFFFFF;
+}
+
+/* Return the next number in the range 0..32767 from the game's sequence. */
+
+static int next_rand()
+{
+	game->rng = (game->rng * 1103515245 + 12345) & 0xFFFFFFFF;
+	return ((int)((game->rng >> 16) & 0x7FFF));
 }
 
 long irand(high)
@@ -36,7 +58,7 @@ long high;
 	if (high < 2) {
 		return (0);
 	}
-	return (rand() % high);
+	return (next_rand() % high);
 }
 
 int rndint(minp, maxp)
@@ -45,7 +67,7 @@ int minp, maxp;
 	int size;
 
 	size = maxp - minp + 1;
-	return ((rand() % size) + minp);
+	return ((next_rand() % size) + minp);
 }
 
 /*
@@ -71,6 +93,33 @@ long a, b;
 	return (MAX (ABS (ax-bx), ABS (ay-by)));
 }
 
+/*
+Find the distance from one location to each of a list of locations,
+given as the row and column of each, putting the distance to the i'th
+location in d[i].  The loop has no branches and reads the lists in
+order, so the compiler can turn it into vector code.
+*/
+
+void
+dist_list (loc, rows, cols, n, d)
+long loc;
+int *rows, *cols;
+long n;
+int *d;
+{
+	int r, c, dr, dc;
+	long i;
+
+	r = loc_row (loc);
+	c = loc_col (loc);
+
+	for (i = 0; i < n; i++) {
+		dr = ABS (rows[i] - r);
+		dc = ABS (cols[i] - c);
+		d[i] = MAX (dr, dc);
+	}
+}
+
 /*
 Find the square root of an integer.  We actually return the floor
 of the square root using Newton's method.
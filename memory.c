@@ -0,0 +1,204 @@
+/* %W% %G% %U% - (c) Copyright 1987, 1988 Chuck Simmons */
+
+/*
+ *    Copyright (C) 1987, 1988 Chuck Simmons
+ *
+ * See the file COPYING, distributed with empire, for restriction
+ * and warranty information.
+ */
+
+/*
+memory.c -- account for the memory used by a game.
+
+The report gives the size of each large array in a game, how big the
+object pool has grown and how much of it is in use, and how deep the
+stack gets below each of the routines that do the most searching.
+The arrays with an entry per cell are sized for the largest map the
+game has held.
+
+Stack depth is only measured while 'stack_probing' is set.  Each entry
+point calls 'stack_enter' when it starts, and the routines at the
+bottom of the searches call 'stack_probe'.  Both record the address
+of a local variable.  comp_move and user_move reset the base of the
+stack; every other depth is measured from there.  An entry point is
+assumed to have returned once we see a stack address at or above its
+own, so nested entry points are each charged with the deepest point
+reached beneath them.  This assumes the stack grows down.
+*/
+
+#include <stdio.h>
+#include <curses.h>
+#include "empire.h"
+#include "extern.h"
+
+static char *stack_name[NUM_STACK] = {
+	"user_move", "comp_move", "comp_prod", "lake", "army_move",
+	"move_explore", "move_to_dest", "vmap_prune_explore_locs"
+};
+
+typedef struct {
+	char *name; /* array name */
+	long size; /* bytes */
+} mem_size_t;
+
+#define MAX_ACTIVE 32 /* deepest nesting of entry points we track */
+
+static long stack_peak[NUM_STACK]; /* deepest point seen below base */
+static char *stack_base; /* stack address at start of turn */
+static char *active_sp[MAX_ACTIVE]; /* entry points we are within */
+static int active_entry[MAX_ACTIVE];
+static int nactive;
+
+/*
+Note where the stack is.  'entry' is the entry point that is starting,
+or -1 if we are just probing.
+*/
+
+void
+stack_mark (entry)
+int entry;
+{
+	char here; /* marks the current stack position */
+	long depth;
+	int i;
+
+	if (entry == ST_USER_MOVE || entry == ST_COMP_MOVE) {
+		stack_base = &here; /* start of a new turn */
+		nactive = 0;
+	}
+	if (stack_base == NULL) return;
+
+	/* forget entry points that have returned */
+	while (nactive > 0 && (&here > active_sp[nactive-1]
+		|| entry >= 0 && &here == active_sp[nactive-1]))
+		nactive--;
+
+	if (entry >= 0 && nactive < MAX_ACTIVE) {
+		active_sp[nactive] = &here;
+		active_entry[nactive++] = entry;
+	}
+	depth = stack_base - &here;
+	for (i = 0; i < nactive; i++)
+		if (depth > stack_peak[active_entry[i]])
+			stack_peak[active_entry[i]] = depth;
+}
+
+/*
+Turn stack measurement on or off.  Depths restart when it is enabled.
+*/
+
+void
+stack_enable (on)
+int on;
+{
+	stack_probing = on;
+	stack_base = NULL;
+	nactive = 0;
+	if (on) (void) bzero ((char *)stack_peak, sizeof (stack_peak));
+}
+
+/*
+Print one line of the report, either to a file or on the screen.
+Headings give 'text' in place of a value.
+*/
+
+static void
+mem_line (f, row, col, name, text, value)
+FILE *f;
+int row, col;
+char *name;
+char *text;
+long value;
+{
+	if (text) (void) sprintf (jnkbuf, "%-24s %12s", name, text);
+	else (void) sprintf (jnkbuf, "%-24s %12ld", name, value);
+
+	if (f) (void) fprintf (f, "%s\n", jnkbuf);
+	else pos_str1 (row, col, "%s", jnkbuf,0,0,0,0,0,0,0);
+}
+
+/*
+Report where the memory goes.  If 'print' is set, the report is
+printed on the standard output; otherwise it is shown on the screen
+in two columns.
+*/
+
+void
+mem_report (print)
+int print;
+{
+	static mem_size_t per_cell[] = { /* bytes for each cell of the map */
+		{"map, occupancy", sizeof (real_map_t) + sizeof (occupancy_t)},
+		{"class, adj, row, col", 2 * sizeof (uchar) + 2 * sizeof (int)},
+		{"comp_map, user_map", 2 * sizeof (view_map_t)},
+		{"seen dates, changes", sizeof (uchar)
+			+ (2 + NUM_OWNERS) * sizeof (int)},
+		{"emap, amap", 2 * sizeof (view_map_t)},
+		{"path maps", 4 * sizeof (path_map_t)},
+		{"cont maps", 4 * sizeof (int)},
+		{"perimeters", 4 * sizeof (long)},
+		{"height, land", 2 * sizeof (int) + sizeof (long) + 3 * sizeof (int)},
+		{"continents", sizeof (int) + sizeof (long)},
+		{"mapbuf, scan stamps", sizeof (char) + sizeof (int)},
+	};
+	static mem_size_t statics[] = {
+		{"obj lists", sizeof (user_obj) + sizeof (comp_obj)
+			+ sizeof (game->sector_obj)},
+		{"continent tables", sizeof (game->cont_tab)
+			+ sizeof (game->pair_tab)},
+		{"game_t total", sizeof (game_t)},
+	};
+	int ncell = sizeof (per_cell) / sizeof (per_cell[0]);
+	int nstatic = sizeof (statics) / sizeof (statics[0]);
+	long nfree, n;
+	int i, r, c;
+	piece_info_t *p;
+	FILE *f;
+
+	f = print ? stdout : NULL;
+	if (f == NULL) clear_screen ();
+	r = NUMTOPS;
+	c = 1;
+
+	mem_line (f, r++, c, "--Game storage--", "bytes", 0L);
+	for (i = 0; i < ncell; i++) /* these grow with the map */
+		mem_line (f, r++, c, per_cell[i].name, NULL,
+			(long)game->map_alloc * per_cell[i].size);
+	mem_line (f, r++, c, "city", NULL, (long)game->city_alloc
+		* (sizeof (city_info_t) + sizeof (int) /* and its link */
+		+ MAX_CONT * sizeof (city_info_t *))); /* and cont_tab */
+	mem_line (f, r++, c, "city grid", NULL,
+		(long)game->grid_alloc * sizeof (int));
+	for (i = 0; i < nstatic; i++)
+		mem_line (f, r++, c, statics[i].name, NULL, statics[i].size);
+
+	/* these grow with the object pool */
+	n = (long)game->obj_nchunk * POOL_CHUNK;
+	mem_line (f, r++, c, "object pool", NULL, n * sizeof (piece_info_t));
+	mem_line (f, r++, c, "object links", NULL, n * sizeof (piece_links_t));
+	mem_line (f, r++, c, "piece, sector index", NULL, 5 * n * sizeof (int));
+	mem_line (f, r++, c, "check tables", NULL, 6 * n * sizeof (int));
+
+	nfree = 0;
+	for (p = OBJ(free_list); p != NULL; p = OBJ(LINKS(p)->piece_link.next))
+		nfree++;
+
+	if (f) (void) fprintf (f, "\n");
+	else {
+		r = NUMTOPS;
+		c = 41;
+	}
+	mem_line (f, r++, c, "--Object pool--", "pieces", 0L);
+	mem_line (f, r++, c, "size", NULL, (long)pool_size);
+	mem_line (f, r++, c, "in use", NULL, (long)obj_used);
+	mem_line (f, r++, c, "free list", NULL, nfree);
+	mem_line (f, r++, c, "high water", NULL, (long)obj_high);
+
+	if (f) (void) fprintf (f, "\n");
+	else r++;
+	mem_line (f, r++, c, "--Stack depth--", "bytes", 0L);
+	for (i = 0; i < NUM_STACK; i++)
+		mem_line (f, r++, c, stack_name[i], NULL, stack_peak[i]);
+
+	if (f == NULL) (void) refresh ();
+}
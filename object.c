@@ -21,10 +21,93 @@ object.c -- routines for manipulating objects.
 #include "empire.h"
 #include "extern.h"
 
+/*
+The grid of cities.  Cities never move, so each city stays in one
+square of the grid, on the list for its current owner; only a change
+of owner moves it from one list to another.  The lists are linked
+through 'city_next' by city reference, and 0 ends a list.
+*/
+
+#define city_grid (game->city_grid)
+#define city_next (game->city_next)
+#define grid_rows (game->grid_rows)
+#define grid_cols (game->grid_cols)
+
+/* the list for an owner and a square of the grid */
+#define GRID_HEAD(owner,row,col) \
+	city_grid[((owner) * grid_rows + (row)) * grid_cols + (col)]
+#define CITY_HEAD(cityp) GRID_HEAD ((cityp)->owner, \
+	loc_row ((cityp)->loc) / CITY_GRID, loc_col ((cityp)->loc) / CITY_GRID)
+
+static void
+grid_add (cityp)
+city_info_t *cityp;
+{
+	int *head;
+
+	head = &CITY_HEAD (cityp);
+	city_next[cityp - game->city] = *head;
+	*head = CITY_REF (cityp);
+	owned_cities[cityp->owner] += 1;
+}
+
+static void
+grid_remove (cityp)
+city_info_t *cityp;
+{
+	int *ref;
+
+	for (ref = &CITY_HEAD (cityp); *ref != CITY_REF (cityp);
+	     ref = &city_next[*ref - 1])
+		ASSERT (*ref != 0);
+	*ref = city_next[cityp - game->city];
+	owned_cities[cityp->owner] -= 1;
+}
+
+/*
+Make the grid again from the owners of the cities.  This is done
+when the cities are placed and when a game is restored or copied.
+*/
+
+void
+city_grid_reset ()
+{
+	int i;
+
+	for (i = 0; i < NUM_OWNERS * grid_rows * grid_cols; i++)
+		city_grid[i] = 0;
+	for (i = 0; i < NUM_OWNERS; i++)
+		owned_cities[i] = 0;
+	for (i = 0; i < NUM_CITY; i++)
+		grid_add (&game->city[i]);
+}
+
+/*
+Give a city to a new owner.  Every change of owner must come
+through here, to keep the grid right.
+*/
+
+void
+set_city_owner (cityp, owner)
+city_info_t *cityp;
+int owner;
+{
+	grid_remove (cityp);
+	cityp->owner = owner;
+	grid_add (cityp);
+	cell_changed (cityp->loc);
+}
+
 /*
 Find the nearest city to a location.  Return the location
 of the city and the estimated cost to reach the city.
 Distances are computed as straight-line distances.
+
+We look at the square of the grid holding 'loc', then at the ring
+of squares around it, and so on outwards.  A city in ring 'r' is at
+least (r-1)*CITY_GRID+1 away, so we can stop as soon as the best city
+found so far is no farther than that.  Of cities at the same distance,
+we choose the first in 'city', as a scan of every city would.
 */
 
 int
@@ -34,18 +117,43 @@ int owner;
 long *city_loc;
 {
 	long best_dist, best_loc;
-	long new_dist, i;
+	long new_dist;
+	int best, ref;
+	int row, col, r, gr, gc, step;
 	
 	best_dist = INFINITY;
 	best_loc = loc;
-	
-	for (i = 0; i < NUM_CITY; i++) 
-	if (city[i].owner == owner) {
-	       new_dist = dist (loc, city[i].loc);
-	       if (new_dist < best_dist) {
-		       best_dist = new_dist;
-		       best_loc = city[i].loc;
-	       }
+	best = 0;
+	if (owned_cities[owner] == 0) {
+		*city_loc = best_loc;
+		return best_dist;
+	}
+	row = loc_row (loc) / CITY_GRID;
+	col = loc_col (loc) / CITY_GRID;
+
+	for (r = 0; r < grid_rows || r < grid_cols; r++) {
+		if (best_dist <= (r - 1) * CITY_GRID) break;
+
+		for (gr = row - r; gr <= row + r; gr++) {
+			if (gr < 0 || gr >= grid_rows) continue;
+			/* only the edges of the ring between its top and bottom */
+			step = (gr == row - r || gr == row + r) ? 1 : 2 * r;
+
+			for (gc = col - r; gc <= col + r; gc += step) {
+				if (gc < 0 || gc >= grid_cols) continue;
+
+				for (ref = GRID_HEAD (owner, gr, gc); ref;
+				     ref = city_next[ref - 1]) {
+					new_dist = dist (loc, game->city[ref - 1].loc);
+					if (new_dist < best_dist
+					 || new_dist == best_dist && ref < best) {
+						best_dist = new_dist;
+						best_loc = game->city[ref - 1].loc;
+						best = ref;
+					}
+				}
+			}
+		}
 	}
 	*city_loc = best_loc;
 	return best_dist;
@@ -58,7 +166,7 @@ Given the location of a city, return the index of that city.
 city_info_t *find_city (loc)
 long loc;
 {
-	return (map[loc].cityp);
+	return (CITY(game->map[loc].cityp));
 }
 
 /*
@@ -92,7 +200,8 @@ piece_info_t *obj;
 
 /*
 Search for an object of a given type at a location.  We scan the
-list of objects at the given location for one of the given type.
+list of objects at the given location for one of the given type,
+unless the cell's occupancy says there is none.
 */
 
 piece_info_t *find_obj (type, loc)
@@ -101,7 +210,9 @@ long loc;
 {
 	piece_info_t *p;
 
-	for (p = map[loc].objp; p != NULL; p = p->loc_link.next)
+	if (!(occupancy[loc].types & (1 << type))) return (NULL);
+
+	for (p = OBJ(game->map[loc].objp); p != NULL; p = OBJ(LINKS(p)->loc_link.next))
 	if (p->type == type) return (p);
 
 	return (NULL);
@@ -117,9 +228,11 @@ long loc;
 {
 	piece_info_t *p;
 
-	for (p = map[loc].objp; p != NULL; p = p->loc_link.next)
+	if (!(occupancy[loc].types & (1 << type))) return (NULL);
+
+	for (p = OBJ(game->map[loc].objp); p != NULL; p = OBJ(LINKS(p)->loc_link.next))
 	if (p->type == type) {
-		if (obj_capacity (p) > p->count) return (p);
+		if (obj_capacity (p) > LINKS(p)->count) return (p);
 	}
 	return (NULL);
 }
@@ -147,24 +260,16 @@ long loc;
 }
 
 /*
-Search a list of objects at a location for any kind of object.
-We prefer transports and carriers to other objects.
+Return the object to show at a location.  We prefer transports and
+carriers to other objects.  The choice is made by occupy when the
+pieces in the cell change; see cell_changed.
 */
 
 piece_info_t *
 find_obj_at_loc (loc)
 long loc;
 {
-	piece_info_t *p, *best;
-	
-	best = map[loc].objp;
-	if (best == NULL) return (NULL); /* nothing here */
-
-	for (p = best->loc_link.next; p != NULL; p = p->loc_link.next)
-	if (p->type > best->type && p->type != SATELLITE)
-		best = p;
-
-	return (best);
+	return (OBJ(occupancy[loc].top));
 }
 
 /*
@@ -174,10 +279,12 @@ If an object is on a ship, remove it from that ship.
 void disembark (obj)
 piece_info_t *obj;
 {
-	if (obj->ship) {
-		UNLINK (obj->ship->cargo, obj, cargo_link);
-		obj->ship->count -= 1;
-		obj->ship = NULL;
+	if (LINKS(obj)->ship) {
+		hash_piece (obj);
+		UNLINK (REF_LINKS(LINKS(obj)->ship)->cargo, obj, cargo_link);
+		REF_LINKS(LINKS(obj)->ship)->count -= 1;
+		LINKS(obj)->ship = 0;
+		hash_piece (obj);
 	}
 }
 
@@ -188,9 +295,157 @@ Move an object onto a ship.
 void embark (ship, obj)
 piece_info_t *ship, *obj;
 {
-	obj->ship = ship;
-	LINK (ship->cargo, obj, cargo_link);
-	ship->count += 1;
+	hash_piece (obj);
+	LINKS(obj)->ship = OBJ_REF(ship);
+	LINK (LINKS(ship)->cargo, obj, cargo_link);
+	LINKS(ship)->count += 1;
+	hash_piece (obj);
+}
+
+/*
+Add a piece to the end of its group in the dense index.  We make room
+by moving the first piece of each later group to the end of that
+group, so at most one piece per group moves.
+*/
+
+void
+vec_add (obj)
+piece_info_t *obj;
+{
+	int g, grp, hole, first;
+
+	grp = VEC_GROUP (obj->owner, obj->type);
+	hole = vec_start[NUM_GROUPS]; /* first unused slot */
+	
+	for (g = NUM_GROUPS - 1; g > grp; g--) {
+		first = vec_start[g];
+		if (first != hole) { /* group not empty? */
+			piece_vec[hole] = piece_vec[first];
+			vec_pos[piece_vec[hole]] = hole;
+		}
+		hole = first;
+		vec_start[g] = first + 1;
+	}
+	vec_start[NUM_GROUPS] += 1;
+	piece_vec[hole] = obj->ref - 1;
+	vec_pos[obj->ref - 1] = hole;
+}
+
+/*
+Remove a piece from the dense index.  The last piece of its group
+fills the hole, which leaves a hole at the end of the group; the last
+piece of each later group fills the hole in front of it in turn.
+*/
+
+void
+vec_remove (obj)
+piece_info_t *obj;
+{
+	int g, hole, last;
+
+	hole = vec_pos[obj->ref - 1];
+	
+	for (g = VEC_GROUP (obj->owner, obj->type); g < NUM_GROUPS; g++) {
+		last = vec_start[g+1] - 1;
+		if (last != hole) {
+			piece_vec[hole] = piece_vec[last];
+			vec_pos[piece_vec[hole]] = hole;
+		}
+		hole = last;
+		vec_start[g+1] = last;
+	}
+}
+
+/*
+The user's pieces are also kept on a list for each sector and type,
+so that user_move can move the pieces of a sector without looking at
+every piece.  Each list is kept in the order of the user's list of
+that type, which is the order in which the pieces went on it, latest
+first; 'list_seq' records that order.
+*/
+
+#define sector_next (game->sector_next)
+#define sector_prev (game->sector_prev)
+#define list_seq (game->list_seq)
+
+static void
+sector_link (obj)
+piece_info_t *obj;
+{
+	int *head;
+	int r, prev, next;
+
+	r = obj->ref;
+	head = &game->sector_obj[loc_sector (obj->loc)][obj->type];
+	prev = 0;
+	for (next = *head; next && list_seq[next-1] > list_seq[r-1];
+	     next = sector_next[next-1])
+		prev = next;
+
+	sector_prev[r-1] = prev;
+	sector_next[r-1] = next;
+	if (prev) sector_next[prev-1] = r;
+	else *head = r;
+	if (next) sector_prev[next-1] = r;
+}
+
+static void
+sector_unlink (obj)
+piece_info_t *obj;
+{
+	int r, prev, next;
+
+	r = obj->ref;
+	prev = sector_prev[r-1];
+	next = sector_next[r-1];
+	if (next) sector_prev[next-1] = prev;
+	if (prev) sector_next[prev-1] = next;
+	else game->sector_obj[loc_sector (obj->loc)][obj->type] = next;
+	sector_next[r-1] = 0;
+	sector_prev[r-1] = 0;
+}
+
+/* put a piece just linked onto the head of the user's list on its sector's list */
+
+static void
+sector_add (obj)
+piece_info_t *obj;
+{
+	list_seq[obj->ref - 1] = ++game->list_count;
+	sector_link (obj);
+}
+
+/*
+Make the sector lists again from the user's lists.  This is done
+when a game is made or restored.
+*/
+
+void
+sector_reset ()
+{
+	piece_info_t *p;
+	int tail[NUM_SECTORS]; /* last piece on each list */
+	int type, sec, r, n;
+
+	(void) bzero ((char *)game->sector_obj, sizeof (game->sector_obj));
+	game->list_count = pool_size; /* no list is longer */
+
+	for (type = 0; type < NUM_OBJECTS; type++) {
+		for (sec = 0; sec < NUM_SECTORS; sec++)
+			tail[sec] = 0;
+		n = 0;
+		for (p = OBJ(user_obj[type]); p != NULL && n < pool_size;
+		     p = OBJ(LINKS(p)->piece_link.next)) {
+			r = p->ref;
+			list_seq[r-1] = pool_size - n++;
+			sec = loc_sector (p->loc);
+			sector_prev[r-1] = tail[sec];
+			sector_next[r-1] = 0;
+			if (tail[sec]) sector_next[tail[sec]-1] = r;
+			else game->sector_obj[sec][type] = r;
+			tail[sec] = r;
+		}
+	}
 }
 
 /*
@@ -204,14 +459,14 @@ long loc;
 {
 	void kill_one();
 
-	piece_info_t **list;
+	int *list;
 	view_map_t *vmap;
 	
 	vmap = MAP(obj->owner);
 	list = LIST(obj->owner);
 	
-	while (obj->cargo != NULL) /* kill contents */
-		kill_one (list, obj->cargo);
+	while (LINKS(obj)->cargo) /* kill contents */
+		kill_one (list, OBJ(LINKS(obj)->cargo));
 
 	kill_one (list, obj);
 	scan (vmap, loc); /* scan around new location */
@@ -220,14 +475,19 @@ long loc;
 /* kill an object without scanning */
 
 void kill_one (list, obj)
-piece_info_t **list;
+int *list;
 piece_info_t *obj;
 {
 	UNLINK (list[obj->type], obj, piece_link); /* unlink obj from all lists */
-	UNLINK (map[obj->loc].objp, obj, loc_link);
+	vec_remove (obj);
+	if (obj->owner == USER) sector_unlink (obj);
+	UNLINK (game->map[obj->loc].objp, obj, loc_link);
+	cell_changed (obj->loc);
 	disembark (obj);
+	hash_piece (obj); /* take obj out of the hash */
 
 	LINK (free_list, obj, piece_link); /* return object to free list */
+	obj_used -= 1;
 	obj->hits = 0; /* let all know this object is dead */
 	obj->moved = piece_attr[obj->type].speed; /* object has moved */
 }
@@ -243,34 +503,41 @@ city_info_t *cityp;
 	view_map_t *vmap;
 	piece_info_t *p;
 	piece_info_t *next_p;
-	piece_info_t **list;
+	int *list;
 	int i;
 	
 	/* change ownership of hardware at this location; but not satellites */
-	for (p = map[cityp->loc].objp; p; p = next_p) {
-		next_p = p->loc_link.next;
+	for (p = OBJ(game->map[cityp->loc].objp); p; p = next_p) {
+		next_p = OBJ(LINKS(p)->loc_link.next);
 		
 		if (p->type == ARMY) kill_obj (p, cityp->loc);
 		else if (p->type != SATELLITE) {
 			if (p->type == TRANSPORT) {
 				list = LIST(p->owner);
 				
-				while (p->cargo != NULL) /* kill contents */
-					kill_one (list, p->cargo);
+				while (LINKS(p)->cargo) /* kill contents */
+					kill_one (list, OBJ(LINKS(p)->cargo));
 			}
+			hash_piece (p);
 			list = LIST (p->owner);
 			UNLINK (list[p->type], p, piece_link);
+			vec_remove (p);
+			if (p->owner == USER) sector_unlink (p);
 			p->owner = (p->owner == USER ? COMP : USER);
+			cell_changed (p->loc);
 			list = LIST (p->owner);
 			LINK (list[p->type], p, piece_link);
+			vec_add (p);
+			if (p->owner == USER) sector_add (p);
 			
 			p->func = NOFUNC;
+			hash_piece (p);
 		}
 	}
 
 	if (cityp->owner != UNOWNED) {
 		vmap = MAP(cityp->owner);
-		cityp->owner = UNOWNED;
+		set_city_owner (cityp, UNOWNED);
 		cityp->work = 0;
 		cityp->prod = NOPIECE;
 		
@@ -282,7 +549,32 @@ city_info_t *cityp;
 }
 
 /*
-Produce an item for a city.
+Add a chunk of free pieces to the object pool.  The new pieces are
+linked so the lowest numbered one is handed out first.  Returns FALSE
+if there is no memory.
+*/
+
+static int
+grow_pool ()
+{
+	piece_info_t *obj;
+	int r;
+
+	if (!pool_reserve (pool_size + POOL_CHUNK)) return (FALSE);
+	for (r = pool_size + POOL_CHUNK; r > pool_size; r--) {
+		obj = POOL_OBJ (r - 1);
+		obj->ref = r;
+		obj->hits = 0; /* mark object as dead */
+		obj->owner = UNOWNED;
+		LINK (free_list, obj, piece_link);
+	}
+	pool_size += POOL_CHUNK;
+	return (TRUE);
+}
+
+/*
+Produce an item for a city.  If the pool is full and cannot grow,
+nothing is produced and the city tries again next turn.
 */
 
 static int sat_dir[4] = {MOVE_NW, MOVE_SW, MOVE_NE, MOVE_SE};
@@ -291,20 +583,23 @@ void
 produce (cityp)
 city_info_t *cityp;
 {
-	piece_info_t **list;
+	int *list;
 	piece_info_t *new;
 	
+	if (free_list == 0 && !grow_pool ())
+		return; /* out of memory */
+
 	list = LIST (cityp->owner);
 
 	cityp->work -= piece_attr[cityp->prod].build_time;
 	
-	ASSERT (free_list); /* can we allocate? */
-	new = free_list;
+	new = OBJ(free_list);
 	UNLINK (free_list, new, piece_link);
+	if (++obj_used > obj_high) obj_high = obj_used;
 	LINK (list[cityp->prod], new, piece_link);
-	LINK (map[cityp->loc].objp, new, loc_link);
-	new->cargo_link.next = NULL;
-	new->cargo_link.prev = NULL;
+	LINK (game->map[cityp->loc].objp, new, loc_link);
+	LINKS(new)->cargo_link.next = 0;
+	LINKS(new)->cargo_link.prev = 0;
 	
 	new->loc = cityp->loc;
 	new->func = NOFUNC;
@@ -312,14 +607,18 @@ city_info_t *cityp;
 	new->owner = cityp->owner;
 	new->type = cityp->prod;
 	new->moved = 0;
-	new->cargo = NULL;
-	new->ship = NULL;
-	new->count = 0;
+	LINKS(new)->cargo = 0;
+	LINKS(new)->ship = 0;
+	LINKS(new)->count = 0;
 	new->range = piece_attr[cityp->prod].range;
+	vec_add (new);
+	if (new->owner == USER) sector_add (new);
+	cell_changed (new->loc);
 	
 	if (new->type == SATELLITE) { /* set random move direction */
 		new->func = sat_dir[irand (4)];
 	}
+	hash_piece (new);
 }
 
 /*
@@ -337,30 +636,52 @@ long new_loc;
 	view_map_t *vmap;
 	long old_loc;
 	piece_info_t *p;
+	int crossing;
 
 	ASSERT (obj->hits);
 	vmap = MAP(obj->owner);
 
+	/* take a user's piece leaving its sector off the sector's lists */
+	crossing = obj->owner == USER
+		&& loc_sector (obj->loc) != loc_sector (new_loc);
+	if (crossing) {
+		sector_unlink (obj);
+		for (p = OBJ(LINKS(obj)->cargo); p != NULL; p = OBJ(LINKS(p)->cargo_link.next))
+			sector_unlink (p);
+	}
+
+	hash_piece (obj);
 	old_loc = obj->loc; /* save original location */
 	obj->moved += 1;
 	obj->loc = new_loc;
 	obj->range--;
+	hash_piece (obj);
 	
 	disembark (obj); /* remove object from any ship */
 	
-	UNLINK (map[old_loc].objp, obj, loc_link);
-	LINK (map[new_loc].objp, obj, loc_link);
+	UNLINK (game->map[old_loc].objp, obj, loc_link);
+	LINK (game->map[new_loc].objp, obj, loc_link);
 
 	/* move any objects contained in object */
-	for (p = obj->cargo; p != NULL; p = p->cargo_link.next) {
+	for (p = OBJ(LINKS(obj)->cargo); p != NULL; p = OBJ(LINKS(p)->cargo_link.next)) {
+		hash_piece (p);
 		p->loc = new_loc;
-		UNLINK (map[old_loc].objp, p, loc_link);
-		LINK (map[new_loc].objp, p, loc_link);
+		hash_piece (p);
+		UNLINK (game->map[old_loc].objp, p, loc_link);
+		LINK (game->map[new_loc].objp, p, loc_link);
+	}
+	cell_changed (old_loc);
+	cell_changed (new_loc);
+
+	if (crossing) { /* and onto the lists for its new sector */
+		sector_link (obj);
+		for (p = OBJ(LINKS(obj)->cargo); p != NULL; p = OBJ(LINKS(p)->cargo_link.next))
+			sector_link (p);
 	}
 	
 	switch (obj->type) { /* board new ship */
 	case FIGHTER:
-		if (map[obj->loc].cityp == NULL) { /* not in a city? */
+		if (!game->map[obj->loc].cityp) { /* not in a city? */
 			p = find_nfull (CARRIER, obj->loc);
 			if (p != NULL) embark (p, obj);
 		}
@@ -373,8 +694,8 @@ long new_loc;
 	}
 
 	if (obj->type == SATELLITE)
-		scan_sat (vmap, obj->loc);
-	scan (vmap, obj->loc);
+		scan_radius (vmap, obj->loc, SAT_RADIUS);
+	else scan (vmap, obj->loc);
 }
 
 /*
@@ -393,10 +714,10 @@ long loc, dir1, dir2, dir3;
 	int new_loc;
 
 	new_loc = loc + dir_offset[MOVE_DIR (dir1)];
-	if (map[new_loc].on_board) return dir1;
+	if (ON_BOARD (new_loc)) return dir1;
 
 	new_loc = loc + dir_offset[MOVE_DIR (dir2)];
-	if (map[new_loc].on_board) return dir2;
+	if (ON_BOARD (new_loc)) return dir2;
 
 	return dir3;
 }
@@ -413,19 +734,19 @@ piece_info_t *obj;
 	dir = MOVE_DIR(obj->func);
 	new_loc = obj->loc + dir_offset[dir];
 
-	if (!map[new_loc].on_board) {
+	if (!ON_BOARD (new_loc)) {
 		switch (obj->func) {
 		case MOVE_NE:
-			obj->func = bounce (obj->loc, MOVE_NW, MOVE_SE, MOVE_SW);
+			set_func (obj, bounce (obj->loc, MOVE_NW, MOVE_SE, MOVE_SW));
 			break;
 		case MOVE_NW:
-			obj->func = bounce (obj->loc, MOVE_NE, MOVE_SW, MOVE_SE);
+			set_func (obj, bounce (obj->loc, MOVE_NE, MOVE_SW, MOVE_SE));
 			break;
 		case MOVE_SE:
-			obj->func = bounce (obj->loc, MOVE_SW, MOVE_NE, MOVE_NW);
+			set_func (obj, bounce (obj->loc, MOVE_SW, MOVE_NE, MOVE_NW));
 			break;
 		case MOVE_SW:
-			obj->func = bounce (obj->loc, MOVE_SE, MOVE_NW, MOVE_NE);
+			set_func (obj, bounce (obj->loc, MOVE_SE, MOVE_NW, MOVE_NE));
 			break;
 		default: ABORT;
 		}
@@ -472,7 +793,7 @@ long loc;
 	view_map_t *vmap;
 	piece_info_t *p;
 	
-	if (!map[loc].on_board) return (FALSE);
+	if (!ON_BOARD (loc)) return (FALSE);
 
 	vmap = MAP (obj->owner);
 
@@ -486,7 +807,7 @@ long loc;
 	}
 
 	/* ships and fighters can move into cities */
-	if (map[loc].cityp && map[loc].cityp->owner == obj->owner)
+	if (game->map[loc].cityp && CITY(game->map[loc].cityp)->owner == obj->owner)
 		return (TRUE);
 
 	/* fighters can move onto unfull carriers */
@@ -515,11 +836,11 @@ piece_info_t *obj;
 		break;
 
 	case TRANSPORT:
-		(void) sprintf (other,"; armies = %d",obj->count);
+		(void) sprintf (other,"; armies = %d",LINKS(obj)->count);
 		break;
 
 	case CARRIER:
-		(void) sprintf (other,"; fighters = %d",obj->count);
+		(void) sprintf (other,"; fighters = %d",LINKS(obj)->count);
 		break;
 	}
 
@@ -546,43 +867,78 @@ scan (vmap, loc)
 view_map_t vmap[];
 long loc;
 {
-	void update(), check();
+	void update();
 
 	int i;
 	long xloc;
+	long start;
 
-#ifdef DEBUG
-	check (); /* perform a consistency check */
-#endif
-	ASSERT (map[loc].on_board); /* passed loc must be on board */
+	start = phase_begin ();
+	if (checking) check_recent (); /* check what has changed */
+	ASSERT (ON_BOARD (loc)); /* passed loc must be on board */
 
 	for (i = 0; i < 8; i++) { /* for each surrounding cell */
 		xloc = loc + dir_offset[i];
 		update (vmap, xloc);
 	}
 	update (vmap, loc); /* update current location as well */
+	phase_end (PH_SCAN, start);
 }
 
 /*
-Scan a portion of the board for a satellite.
+Scan the cells within 'radius' of a location, as a satellite does.
+What is seen is what a scan from every on board cell an even number
+of rows and columns away (up to radius-1) would see, so near the edge
+of the board a little less is seen.  Those scans overlap; to update
+each cell only once, we stamp the cells as we go and skip any cell
+that already carries this call's stamp.
 */
 
 void
-scan_sat (vmap, loc)
+scan_radius (vmap, loc, radius)
 view_map_t *vmap;
 long loc;
+int radius;
 {
-	int i;
-	long xloc;
-	
-	ASSERT (map[loc].on_board);
+	void update();
 
-	for (i = 0; i < 8; i++) { /* for each surrounding cell */
-		xloc = loc + 2 * dir_offset[i];
-		if (xloc >= 0 && xloc < MAP_SIZE && map[xloc].on_board)
-			scan (vmap, xloc);
+	int *stamp;
+	int row, col, r, c, i;
+	long xloc, yloc;
+	long start;
+
+	start = phase_begin ();
+	if (checking) check_recent (); /* check what has changed */
+	ASSERT (ON_BOARD (loc));
+
+	if (++game->scan_count <= 0) { /* stamps wrapped around */
+		(void) bzero ((char *)game->scan_stamp, MAP_SIZE * sizeof (int));
+		game->scan_count = 1;
+	}
+	stamp = game->scan_stamp;
+	row = loc_row (loc);
+	col = loc_col (loc);
+
+	for (r = row - radius + 1; r <= row + radius - 1; r += 2)
+	for (c = col - radius + 1; c <= col + radius - 1; c += 2) {
+		if (r < 0 || r >= MAP_HEIGHT || c < 0 || c >= MAP_WIDTH)
+			continue;
+		xloc = row_col_loc (r, c);
+		if (!ON_BOARD (xloc)) continue;
+
+		for (i = 0; i < 8; i++) { /* for each surrounding cell */
+			yloc = xloc + dir_offset[i];
+			if (stamp[yloc] != game->scan_count) {
+				stamp[yloc] = game->scan_count;
+				update (vmap, yloc);
+			}
+		}
+		if (stamp[xloc] != game->scan_count) {
+			stamp[xloc] = game->scan_count;
+			update (vmap, xloc);
+		}
 	}
-	scan (vmap, loc);
+	phase_end (PH_SCAN, start);
 }
 
 /*
@@ -600,16 +956,16 @@ long loc;
 {
 	piece_info_t *p;
 
-	vmap[loc].seen = date;
+	SEEN(vmap)[loc] = game->date;
 	
-	if (map[loc].cityp) /* is there a city here? */
-		vmap[loc].contents = city_char[map[loc].cityp->owner];
+	if (game->map[loc].cityp) /* is there a city here? */
+		vmap[loc].contents = city_char[CITY(game->map[loc].cityp)->owner];
 	
 	else {
 		p = find_obj_at_loc (loc);
 		
 		if (p == NULL) /* nothing here? */
-			vmap[loc].contents = map[loc].contents;
+			vmap[loc].contents = game->map[loc].contents;
 		else if (p->owner == USER)
 			vmap[loc].contents = piece_attr[p->type].sname;
 		else vmap[loc].contents = tolower (piece_attr[p->type].sname);
@@ -620,6 +976,133 @@ long loc;
 		display_locx (USER, user_map, loc);
 }
 
+/*
+Summarize the pieces in a cell.  The piece shown is the first piece,
+if that is a satellite, and otherwise the first piece of the highest
+type that is not a satellite.
+*/
+
+static void
+occupy (loc)
+long loc;
+{
+	occupancy_t *occ;
+	piece_info_t *p, *best;
+
+	occ = &occupancy[loc];
+	occ->types = 0;
+	occ->count = 0;
+	occ->owners = 0;
+
+	best = OBJ(game->map[loc].objp);
+	for (p = best; p != NULL; p = OBJ(LINKS(p)->loc_link.next)) {
+		occ->types |= 1 << p->type;
+		occ->count += 1;
+		occ->owners |= 1 << p->owner;
+		if (p->type > best->type && p->type != SATELLITE)
+			best = p;
+	}
+	occ->top = OBJ_REF (best);
+}
+
+/*
+Note that what is in a cell has changed.  This must be done whenever
+a piece enters or leaves a cell or changes owner, to keep the cell's
+occupancy right.  Each player will look at the cell again at the
+start of the player's next turn; see scan_changes.  If we are
+checking, the checker looks at it too; see check_recent.
+*/
+
+void
+cell_changed (loc)
+long loc;
+{
+	int owner;
+
+	occupy (loc);
+	for (owner = checking ? UNOWNED : USER; owner < NUM_OWNERS; owner++)
+	if (!(game->changed[loc] & (1 << owner))) {
+		game->changed[loc] |= 1 << owner;
+		game->changes[owner][game->nchanged[owner]++] = loc;
+	}
+}
+
+/*
+Forget what the players have looked at, and count every cell as
+changed, summarizing the pieces in each.  This is done when a game
+is made or restored.
+*/
+
+void
+all_changed ()
+{
+	long i;
+
+	(void) bzero ((char *)game->changed, MAP_SIZE * sizeof (uchar));
+	(void) bzero ((char *)game->nchanged, sizeof (game->nchanged));
+	for (i = 0; i < MAP_SIZE; i++)
+		cell_changed (i);
+}
+
+/*
+Return TRUE if a player looks around a location at the start of a
+turn: the player has a piece there or, for the user, a city.  The
+computer looks around its cities later, as it sets their production.
+*/
+
+static int
+watching (owner, loc)
+int owner;
+long loc;
+{
+	if (owner == USER && game->map[loc].cityp
+	 && CITY(game->map[loc].cityp)->owner == USER)
+		return (TRUE);
+
+	return ((occupancy[loc].owners & (1 << owner)) != 0);
+}
+
+/*
+Bring a player's view of the world up to date at the start of a
+turn.  The cells around the player's pieces and cities were updated
+when they got there, so only the cells that have changed since then
+need another look.  We update those the player is watching and drop
+the rest from the list; they are seen again when a piece moves next
+to them.
+*/
+
+void
+scan_changes (owner)
+int owner;
+{
+	int *list;
+	long loc, new_loc;
+	long i, start;
+	int j;
+	view_map_t *vmap;
+
+	start = phase_begin ();
+	vmap = MAP(owner);
+	list = game->changes[owner];
+
+	for (i = 0; i < game->nchanged[owner]; i++) {
+		loc = list[i];
+		game->changed[loc] &= ~(1 << owner);
+
+		if (watching (owner, loc)) {
+			update (vmap, loc);
+			continue;
+		}
+		FOR_ADJ_ON (loc, new_loc, j)
+		if (watching (owner, new_loc)) {
+			update (vmap, loc);
+			break;
+		}
+	}
+	game->nchanged[owner] = 0;
+	phase_end (PH_SCAN, start);
+}
+
 /*
 Set the production for a city.  We make sure the city is displayed
 on the screen, and we ask the user for the new production.  We keep
@@ -645,7 +1128,7 @@ city_info_t *cityp;
 			
 		else {
 			cityp->prod = i;
-			city->work = -(piece_attr[i].build_time / 5);
+			game->city->work = -(piece_attr[i].build_time / 5);
 			return;
 		}
 	}
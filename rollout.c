@@ -0,0 +1,153 @@
+/* %W% %G% %U% - (c) Copyright 1987, 1988 Chuck Simmons */
+
+/*
+ *    Copyright (C) 1987, 1988 Chuck Simmons
+ *
+ * See the file COPYING, distributed with empire, for restriction
+ * and warranty information.
+ */
+
+/*
+rollout.c -- play the computer's side a few turns ahead.
+
+A rollout copies the current game into a scratch game and lets the
+computer play on alone for a number of turns, then scores the
+position it reached.  The production planner (comp_plan) uses this
+to compare production plans: each plan is played out from the same
+position and the one that scores best is kept.
+
+A rollout turn is a stripped down comp_move.  Nothing is shown on
+the screen or written to the message log while 'rolling_out' is
+set, so a fight costs only the dice; the game is never saved; and
+timing, tracing and stack probing are suspended so the rollouts do
+not disturb the figures for the real game.  The user's pieces stand
+still, as in a batch game, so the computer's view of the world only
+has to be refreshed once, at the start of the rollout.  The scratch
+game has its own random numbers, so a rollout never changes what
+happens in the real game.
+*/
+
+#ifdef SYSV
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+
+#include <curses.h>
+#include "empire.h"
+#include "extern.h"
+
+#define emap (game->emap) /* pruned explore map */
+
+#define CITY_VALUE 100 /* a city is worth this much work */
+
+static game_t *scratch; /* game the rollouts are played in */
+
+/*
+Return the value of the position for the computer:  the value of its
+cities and pieces less the value of the user's.  Pieces are valued
+by the work needed to build them.
+*/
+
+static long
+rollout_score ()
+{
+	long score;
+	int i;
+
+	score = 0;
+	for (i = 0; i < NUM_CITY; i++) {
+		if (game->city[i].owner == COMP) score += CITY_VALUE;
+		else if (game->city[i].owner == USER) score -= CITY_VALUE;
+	}
+	for (i = 0; i < NUM_OBJECTS; i++)
+		score += piece_attr[i].build_time
+			* (COUNT_PIECES (COMP, i) - COUNT_PIECES (USER, i));
+	return (score);
+}
+
+/*
+Return TRUE if either side has lost all its cities.
+*/
+
+static int
+rollout_over ()
+{
+	int i, nuser, ncomp;
+
+	nuser = 0;
+	ncomp = 0;
+	for (i = 0; i < NUM_CITY; i++) {
+		if (game->city[i].owner == USER) nuser++;
+		else if (game->city[i].owner == COMP) ncomp++;
+	}
+	return (nuser == 0 || ncomp == 0);
+}
+
+/*
+Play one turn for the computer.
+*/
+
+static void
+rollout_turn ()
+{
+	void do_cities(), do_pieces();
+
+	(void) memcpy (emap, comp_map, MAP_SIZE * sizeof (view_map_t));
+	vmap_prune_explore_locs (emap);
+
+	do_cities (); /* handle city production */
+	do_pieces (); /* move pieces */
+	game->date += 1;
+}
+
+/*
+Play the current game ahead for 'turns' turns using the production
+ratios in 'plan' (NULL for the usual ones) and return the score of the
+position reached.  The current game is not changed.
+*/
+
+long
+rollout (plan, turns)
+int *plan;
+int turns;
+{
+	game_t *real;
+	char save_timing, save_tracing, save_probing;
+	long score;
+	int i;
+
+	if (scratch == NULL) {
+		scratch = alloc_game ();
+		if (scratch == NULL) return (0);
+	}
+	real = game;
+	if (!copy_game (scratch, real)) return (0);
+	game = scratch;
+
+	save_timing = timing; /* keep rollouts out of the figures */
+	save_tracing = tracing;
+	save_probing = stack_probing;
+	timing = FALSE;
+	tracing = FALSE;
+	stack_probing = FALSE;
+	rolling_out = TRUE;
+
+	prod_plan = plan;
+	print_debug = FALSE;
+	trace_pmap = FALSE;
+	save_movie = FALSE;
+
+	scan_changes (COMP); /* refresh comp's view of world */
+
+	for (i = 0; i < turns && !rollout_over (); i++)
+		rollout_turn ();
+	score = rollout_score ();
+
+	rolling_out = FALSE;
+	timing = save_timing;
+	tracing = save_tracing;
+	stack_probing = save_probing;
+	game = real;
+	return (score);
+}
@@ -0,0 +1,303 @@
+/* %W% %G% %U% - (c) Copyright 1987, 1988 Chuck Simmons */
+
+/*
+ *    Copyright (C) 1987, 1988 Chuck Simmons
+ *
+ * See the file COPYING, distributed with empire, for restriction
+ * and warranty information.
+ */
+
+/*
+stats.c -- time the phases of each turn.
+
+When 'timing' is set, the interesting parts of a turn are bracketed
+by 'phase_begin' and 'phase_end', which read a monotonic clock and
+accumulate the time and number of calls for each phase.  Phases may
+nest; a scan performed while moving a piece is charged both to the
+scan phase and to the piece's phase.
+
+At the end of each computer turn we append one line to 'empstats.dat'
+giving the date and, for each phase that ran, its name, the number of
+calls, and the microseconds spent.  Totals since timing was turned on
+can be displayed with the "!=" debugging command.
+
+While timing, we also count the work done by the path searches in
+map.c, charged to the move_info that started the search.  For each
+caller we count searches, perimeter cells expanded, objectives
+evaluated and objectives found, plus a histogram of perimeter sizes
+with power of two buckets.  One line per caller is appended to
+'empsearch.dat' each turn, and "!#" displays the totals.
+*/
+
+#include <stdio.h>
+#include <time.h>
+#include <curses.h>
+#include "empire.h"
+#include "extern.h"
+
+static char *phase_name[NUM_PHASES] = {
+	"user_move", "comp_move", "do_cities",
+	"army", "fighter", "patrol", "destroyer", "submarine",
+	"transport", "carrier", "battleship", "satellite",
+	"prune", "unload_map", "scan", "save_game", "save_movie", "plan"
+};
+
+static long turn_nsec[NUM_PHASES]; /* time and calls this turn */
+static long turn_calls[NUM_PHASES];
+static long total_nsec[NUM_PHASES]; /* time and calls since enabled */
+static long total_calls[NUM_PHASES];
+
+/* Searches are charged to the move_info they were started with. */
+
+static move_info_t *search_info[] = {
+	&tt_load, &tt_explore, &tt_unload, &army_fight, &army_load,
+	&fighter_fight, &ship_fight, &ship_repair, &user_army,
+	&user_army_attack, &user_fighter, &user_ship, &user_ship_repair
+};
+static char *search_name[] = {
+	"tt_load", "tt_explore", "tt_unload", "army_fight", "army_load",
+	"fighter_fight", "ship_fight", "ship_repair", "user_army",
+	"user_army_attack", "user_fighter", "user_ship", "user_ship_repair",
+	"find_dest", "other"
+};
+
+#define S_DEST 13 /* vmap_find_dest's private move_info */
+#define S_OTHER 14 /* anything else */
+#define NUM_SEARCH 15
+#define NUM_BUCKET 14 /* perimeter size buckets: 1, 2-3, 4-7, ... */
+
+typedef struct {
+	long calls; /* searches started */
+	long cells; /* perimeter cells expanded */
+	long evals; /* objectives evaluated */
+	long found; /* cells that were objectives */
+	long hist[NUM_BUCKET]; /* perimeter sizes */
+} search_stats_t;
+
+static search_stats_t turn_search[NUM_SEARCH];
+static search_stats_t total_search[NUM_SEARCH];
+static int search_caller; /* who the current search is charged to */
+
+/*
+Return a monotonic time stamp in nanoseconds.
+*/
+
+long
+stats_now ()
+{
+	struct timespec ts;
+
+	(void) clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (long)ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/*
+Charge the time since 'start' to a phase.
+*/
+
+void
+stats_phase (phase, start)
+int phase;
+long start;
+{
+	turn_nsec[phase] += stats_now () - start;
+	turn_calls[phase] += 1;
+}
+
+/*
+A path search is starting.  Remember who to charge it to.
+*/
+
+void
+stats_search (move_info)
+move_info_t *move_info;
+{
+	int i;
+
+	for (i = 0; i < S_DEST; i++)
+		if (search_info[i] == move_info) break;
+
+	if (i < S_DEST) search_caller = i;
+	else if (move_info->objectives[0] == '%') search_caller = S_DEST;
+	else search_caller = S_OTHER;
+
+	turn_search[search_caller].calls += 1;
+}
+
+/*
+A perimeter of 'len' cells is being expanded.
+*/
+
+void
+stats_perimeter (len)
+long len;
+{
+	int b;
+
+	turn_search[search_caller].cells += len;
+	for (b = 0; len > 1 && b < NUM_BUCKET-1; b++)
+		len >>= 1;
+	turn_search[search_caller].hist[b] += 1;
+}
+
+/*
+An objective was evaluated.  'found' is TRUE if the cell was one.
+*/
+
+void
+stats_objective (found)
+int found;
+{
+	turn_search[search_caller].evals += 1;
+	if (found) turn_search[search_caller].found += 1;
+}
+
+/*
+Write out the search counts for a turn and fold them into the totals.
+*/
+
+static void
+stats_search_turn ()
+{
+	FILE *f;
+	int i, b;
+	search_stats_t *s, *t;
+
+	f = fopen ("empsearch.dat", "a"); /* open for append */
+	if (f == NULL) {
+		error ("Cannot open empsearch.dat",0,0,0,0,0,0,0,0);
+		return;
+	}
+	for (i = 0; i < NUM_SEARCH; i++) {
+		s = &turn_search[i];
+		t = &total_search[i];
+		if (s->calls == 0) continue;
+
+		(void) fprintf (f, "%ld %s %ld %ld %ld %ld", game->date, search_name[i],
+			s->calls, s->cells, s->evals, s->found);
+		for (b = 0; b < NUM_BUCKET; b++) {
+			(void) fprintf (f, "%c%ld", b ? ',' : ' ', s->hist[b]);
+			t->hist[b] += s->hist[b];
+		}
+		(void) fprintf (f, "\n");
+		t->calls += s->calls;
+		t->cells += s->cells;
+		t->evals += s->evals;
+		t->found += s->found;
+	}
+	(void) fclose (f);
+	(void) bzero ((char *)turn_search, sizeof (turn_search));
+}
+
+/*
+Turn timing on or off.  Totals restart whenever timing is enabled.
+*/
+
+void
+stats_enable (on)
+int on;
+{
+	timing = on;
+	(void) bzero ((char *)turn_nsec, sizeof (turn_nsec));
+	(void) bzero ((char *)turn_calls, sizeof (turn_calls));
+	(void) bzero ((char *)turn_search, sizeof (turn_search));
+	if (on) {
+		(void) bzero ((char *)total_nsec, sizeof (total_nsec));
+		(void) bzero ((char *)total_calls, sizeof (total_calls));
+		(void) bzero ((char *)total_search, sizeof (total_search));
+	}
+}
+
+/*
+A turn is over.  Write out what it cost and fold it into the totals.
+*/
+
+void
+stats_turn ()
+{
+	FILE *f;
+	int i;
+
+	if (!timing) return;
+
+	f = fopen ("empstats.dat", "a"); /* open for append */
+	if (f == NULL) {
+		error ("Cannot open empstats.dat",0,0,0,0,0,0,0,0);
+		return;
+	}
+	(void) fprintf (f, "%ld", game->date);
+	for (i = 0; i < NUM_PHASES; i++) {
+		if (turn_calls[i])
+			(void) fprintf (f, " %s:%ld:%ld", phase_name[i],
+				turn_calls[i], turn_nsec[i] / 1000);
+		total_nsec[i] += turn_nsec[i];
+		total_calls[i] += turn_calls[i];
+		turn_nsec[i] = 0;
+		turn_calls[i] = 0;
+	}
+	(void) fprintf (f, "\n");
+	(void) fclose (f);
+
+	stats_search_turn ();
+}
+
+/*
+Display the totals for each phase.
+*/
+
+void
+stats_display ()
+{
+	int i;
+
+	clear_screen ();
+	pos_str (NUMTOPS, 1, "--Phase-------------Calls--------msec------usec/call",0,0,0,0,0,0,0,0);
+
+	for (i = 0; i < NUM_PHASES; i++) {
+		pos_str1 (NUMTOPS + 1 + i, 1, "%-12s", phase_name[i],0,0,0,0,0,0,0);
+		pos_str (NUMTOPS + 1 + i, 14, "%11d %11d %15d",
+			(int) total_calls[i],
+			(int) (total_nsec[i] / 1000000),
+			(int) (total_calls[i] ? total_nsec[i] / 1000 / total_calls[i] : 0),
+			0,0,0,0,0);
+	}
+	(void) refresh ();
+}
+
+/*
+Display the search totals for each caller.  The histogram shows the
+number of perimeters in each bucket, scaled to a digit.
+*/
+
+void
+stats_search_display ()
+{
+	int i, b;
+	long most;
+	search_stats_t *t;
+	char hist[NUM_BUCKET+1];
+
+	clear_screen ();
+	pos_str (NUMTOPS, 1, "--Caller-----------Calls---Cells/call---Evals/call--Found/call--Perimeters",0,0,0,0,0,0,0,0);
+
+	for (i = 0; i < NUM_SEARCH; i++) {
+		t = &total_search[i];
+		most = 0;
+		for (b = 0; b < NUM_BUCKET; b++)
+			if (t->hist[b] > most) most = t->hist[b];
+		for (b = 0; b < NUM_BUCKET; b++)
+			hist[b] = t->hist[b] ? '0' + (t->hist[b] * 9 + most - 1) / most : '.';
+		hist[NUM_BUCKET] = 0;
+
+		pos_str1 (NUMTOPS + 1 + i, 1, "%-16s", search_name[i],0,0,0,0,0,0,0);
+		if (t->calls == 0) continue;
+		pos_str (NUMTOPS + 1 + i, 18, "%6d %12d %12d %11d",
+			(int) t->calls,
+			(int) (t->cells / t->calls),
+			(int) (t->evals / t->calls),
+			(int) (t->found / t->calls),
+			0,0,0,0);
+		pos_str1 (NUMTOPS + 1 + i, 62, "%s", hist,0,0,0,0,0,0,0);
+	}
+	(void) refresh ();
+}
@@ -27,6 +27,9 @@ When information is to be displayed, if the 'need_delay' flag is set,
 we refresh the screen and pause momentarily to give the user a chance
 to read the lines.  The new information is then displayed, and the
 'need_delay' flag is set.
+
+Nothing at all is printed while a rollout is being played (see
+rollout.c).
 */
 
 #include <stdio.h>
@@ -70,6 +73,7 @@ int linep;
 char *buf;
 int a, b, c, d, e, f, g, h;
 {
+	if (rolling_out) return; /* nobody to see it */
 	if (linep < 1 || linep > NUMTOPS)
 		linep = 1;
 	(void) move (linep - 1, 0);
@@ -87,6 +91,7 @@ char *buf;
 char *a;
 int b, c, d, e, f, g, h;
 {
+	if (rolling_out) return; /* nobody to see it */
 	if (linep < 1 || linep > NUMTOPS)
 		linep = 1;
 	(void) move (linep - 1, 0);
@@ -103,6 +108,7 @@ char *buf;
 char *a, *e, *f;
 int b, c, d, g, h;
 {
+	if (rolling_out) return; /* nobody to see it */
 	if (linep < 1 || linep > NUMTOPS)
 		linep = 1;
 	(void) move (linep - 1, 0);
@@ -185,6 +191,7 @@ void
 info (a, b, c)
 char *a, *b, *c;
 {
+	if (rolling_out) return;
 	if (need_delay) delay ();
 	topmsg (1, a,0,0,0,0,0,0,0,0);
 	topmsg (2, b,0,0,0,0,0,0,0,0);
@@ -194,6 +201,7 @@ char *a, *b, *c;
 
 void
 set_need_delay () {
+	if (rolling_out) return;
 	need_delay = 1;
 }
 
@@ -202,6 +210,7 @@ comment (buf, a, b, c, d, e, f, g, h)
 char *buf;
 int a, b, c, d, e, f, g, h;
 {
+	if (rolling_out) return;
 	if (need_delay) delay ();
 	topmsg (1, 0,0,0,0,0,0,0,0,0);
 	topmsg (2, 0,0,0,0,0,0,0,0,0);
@@ -214,6 +223,7 @@ comment1 (buf, a, b, c, d, e, f, g, h)
 char *buf, *a;
 int b, c, d, e, f, g, h;
 {
+	if (rolling_out) return;
 	if (need_delay) delay ();
 	topmsg1 (1, 0,0,0,0,0,0,0,0,0);
 	topmsg1 (2, 0,0,0,0,0,0,0,0,0);
@@ -227,6 +237,7 @@ ksend (buf, a, b, c, d, e, f, g, h)
 char *buf;
 int a,b,c,d,e,f,g,h;
 {
+	if (rolling_out) return;
 	if(!(my_stream=fopen("info_list.txt","a")))
 	{
 		error("Cannot open info_list.txt",0,0,0,0,0,0,0,0);
@@ -241,6 +252,7 @@ ksend1 (buf, a, b, c, d, e, f, g, h)
 char *buf, *a;
 int b,c,d,e,f,g,h;
 {
+	if (rolling_out) return;
 	if(!(my_stream=fopen("info_list.txt","a")))
 	{
 		error("Cannot open info_list.txt",0,0,0,0,0,0,0,0);
@@ -0,0 +1,396 @@
+/* %W% %G% %U% - (c) Copyright 1987, 1988 Chuck Simmons */
+
+/*
+ *    Copyright (C) 1987, 1988 Chuck Simmons
+ *
+ * See the file COPYING, distributed with empire, for restriction
+ * and warranty information.
+ */
+
+/*
+tourney.c -- play many seeded games in parallel and summarize them.
+
+usage: vms-empire-tourney [-j workers] [-n games] [-r seed] [-w water]
+                          [-s smooth] [-W width] [-H height] [-c cities]
+                          [-l level] [-t turns] [-i interval] [-a turns]
+                          [-v]
+
+    -j workers:  number of worker processes.  Default is one per
+                 processor.
+
+    -n games:    number of games to play.  Default is 100.
+
+    -r seed:     seed of the first game; game k uses seed+k.
+                 Default is 1.
+
+    -w water, -s smooth:  as for empire.  Defaults are 70 and 5.
+
+    -W width, -H height:  size of the map, as for empire.  Defaults
+                 are 100 and 60.
+
+    -c cities:   number of cities, as for empire.  Default is 70.
+
+    -l level:    difficulty level (continent pair) to start from.
+                 Default is 0.
+
+    -t turns:    most turns to play in one game.  Default is 500.
+
+    -i interval: record the number of cities each side owns every
+                 interval turns.  Default is 50.
+
+    -a turns:    let the computer plan its production by looking the
+                 given number of turns ahead, as for empire.  Default
+                 is 0.
+
+    -v:          print the result of each game as it arrives.
+
+Games are played as with 'empire -b': the computer plays alone against
+a user who never moves.  Each worker is forked with a pipe back to us
+and plays every j'th game.  For each game it writes one line giving
+the seed, the winner, the number of turns, the time the computer spent
+thinking, and the cities owned over time.  We collect the lines as
+they arrive and print a summary table at the end.
+*/
+
+#ifdef SYSV
+#include <string.h>
+#else
+#include <strings.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/select.h>
+#include "empire.h"
+#include "extern.h"
+
+#define OPTFLAGS "j:n:r:w:s:W:H:c:l:t:i:a:v"
+
+#define MAX_WORKERS 256
+#define MAX_SAMPLES 64 /* most city counts recorded per game */
+#define LINE_SIZE 1024 /* longest result line */
+
+typedef struct {
+	int fd; /* read end of worker's pipe, or -1 when done */
+	int pid;
+	int len; /* bytes of partial line in buf */
+	char buf[LINE_SIZE];
+} worker_t;
+
+static worker_t worker[MAX_WORKERS];
+
+static int ngames, first_seed, water, smooth, level, max_turns, interval;
+static int width, height, ncities;
+static int horizon;
+static int verbose;
+
+/* totals over all games */
+static long nplayed, comp_wins, user_wins, unfinished;
+static long turns_sum, finished_turns_sum;
+static long think_usec_sum, worst_turn_usec;
+static long comp_city_sum[MAX_SAMPLES], user_city_sum[MAX_SAMPLES];
+static long sample_games[MAX_SAMPLES]; /* games still going at sample */
+
+/*
+Play one game and write its result line to 'f'.
+*/
+
+static void
+play_game (f, seed)
+FILE *f;
+int seed;
+{
+	int nuser, ncomp, nsamples;
+	int user_cities[MAX_SAMPLES], comp_cities[MAX_SAMPLES];
+	long start, think, worst, usec;
+	int i;
+	char *winner;
+
+	SMOOTH = smooth;
+	WATER_RATIO = water;
+	MIN_CITY_DIST = isqrt (MAP_SIZE * (100 - WATER_RATIO) / 100 / NUM_CITY);
+	rndset ((long)seed);
+	init_game ();
+
+	think = 0;
+	worst = 0;
+	nsamples = 0;
+	while (game->win == 0 && game->date < max_turns) {
+		start = stats_now ();
+		comp_move (1);
+		usec = (stats_now () - start) / 1000;
+		think += usec;
+		if (usec > worst) worst = usec;
+
+		if (game->date % interval == 0 && nsamples < MAX_SAMPLES) {
+			user_cities[nsamples] = owned_cities[USER];
+			comp_cities[nsamples] = owned_cities[COMP];
+			nsamples++;
+		}
+	}
+	nuser = owned_cities[USER];
+	ncomp = owned_cities[COMP];
+	if (game->win == 0) winner = "none";
+	else if (ncomp > nuser) winner = "computer";
+	else winner = "user";
+
+	(void) fprintf (f, "%d %s %ld %ld %ld %d %d %d", seed, winner, game->date,
+		think, worst, nuser, ncomp, nsamples);
+	for (i = 0; i < nsamples; i++)
+		(void) fprintf (f, " %d:%d", user_cities[i], comp_cities[i]);
+	(void) fprintf (f, "\n");
+	(void) fflush (f);
+}
+
+/*
+Worker 'w' of 'nworkers' plays its share of the games.
+*/
+
+static void
+run_worker (fd, w, nworkers)
+int fd, w, nworkers;
+{
+	FILE *f;
+	int g;
+
+	f = fdopen (fd, "w");
+	if (f == NULL) exit (1);
+
+	game = alloc_game ();
+	if (game == NULL || !set_map_size (width, height)
+	 || !set_city_count (ncities)) exit (1);
+
+	for (g = w; g < ngames; g += nworkers)
+		play_game (f, first_seed + g);
+
+	(void) fclose (f);
+	exit (0);
+}
+
+/*
+Fold one result line into the totals.
+*/
+
+static void
+add_result (line)
+char *line;
+{
+	int seed, turns, nuser, ncomp, nsamples, i, n;
+	long think, worst;
+	int uc, cc;
+	char winner[16];
+	char *p;
+
+	if (sscanf (line, "%d %15s %d %ld %ld %d %d %d%n", &seed, winner,
+		&turns, &think, &worst, &nuser, &ncomp, &nsamples, &n) != 8) {
+		(void) fprintf (stderr, "tourney: bad result: %s\n", line);
+		return;
+	}
+	if (verbose) (void) printf ("%s\n", line);
+
+	nplayed++;
+	turns_sum += turns;
+	think_usec_sum += think;
+	if (worst > worst_turn_usec) worst_turn_usec = worst;
+
+	if (strcmp (winner, "computer") == 0) {
+		comp_wins++;
+		finished_turns_sum += turns;
+	}
+	else if (strcmp (winner, "user") == 0) {
+		user_wins++;
+		finished_turns_sum += turns;
+	}
+	else unfinished++;
+
+	p = line + n;
+	for (i = 0; i < nsamples && i < MAX_SAMPLES; i++) {
+		if (sscanf (p, " %d:%d%n", &uc, &cc, &n) != 2) break;
+		p += n;
+		user_city_sum[i] += uc;
+		comp_city_sum[i] += cc;
+		sample_games[i]++;
+	}
+}
+
+/*
+Read what a worker has sent and handle each complete line.
+Returns FALSE when the worker has closed its pipe.
+*/
+
+static int
+read_worker (wp)
+worker_t *wp;
+{
+	int n;
+	char *nl;
+
+	n = read (wp->fd, wp->buf + wp->len, LINE_SIZE - 1 - wp->len);
+	if (n <= 0) return (FALSE);
+	wp->len += n;
+	wp->buf[wp->len] = 0;
+
+	while ((nl = strchr (wp->buf, '\n')) != NULL) {
+		*nl = 0;
+		add_result (wp->buf);
+		wp->len -= nl + 1 - wp->buf;
+		(void) memmove (wp->buf, nl + 1, wp->len + 1);
+	}
+	if (wp->len == LINE_SIZE - 1) wp->len = 0; /* junk; drop it */
+	return (TRUE);
+}
+
+/*
+Print the summary table.
+*/
+
+static void
+report ()
+{
+	int i;
+	long games_going;
+
+	(void) printf ("games %ld  seeds %d..%d  water %d  smooth %d  level %d  turn cap %d  lookahead %d\n",
+		nplayed, first_seed, first_seed + ngames - 1, water, smooth,
+		level, max_turns, horizon);
+	if (nplayed == 0) return;
+
+	(void) printf ("computer wins %ld  user wins %ld  unfinished %ld\n",
+		comp_wins, user_wins, unfinished);
+	(void) printf ("mean turns %ld", turns_sum / nplayed);
+	if (comp_wins + user_wins)
+		(void) printf ("  mean turns to finish %ld",
+			finished_turns_sum / (comp_wins + user_wins));
+	(void) printf ("\n");
+	(void) printf ("computer think time: mean %ld usec/turn, worst turn %ld usec\n",
+		turns_sum ? think_usec_sum / turns_sum : 0L, worst_turn_usec);
+
+	(void) printf ("\n%8s %8s %12s %12s\n",
+		"turn", "games", "user cities", "comp cities");
+	for (i = 0; i < MAX_SAMPLES && sample_games[i]; i++) {
+		games_going = sample_games[i];
+		(void) printf ("%8d %8ld %12.1f %12.1f\n", (i + 1) * interval,
+			games_going,
+			(double) user_city_sum[i] / games_going,
+			(double) comp_city_sum[i] / games_going);
+	}
+}
+
+main (argc, argv)
+int argc;
+char *argv[];
+{
+	int c;
+	extern char *optarg;
+	extern int optind;
+	int errflg = 0;
+	int nworkers, w, fds[2], nfds, open_workers;
+	fd_set readfds;
+
+	nworkers = sysconf (_SC_NPROCESSORS_ONLN); /* set defaults */
+	ngames = 100;
+	first_seed = 1;
+	water = 70;
+	smooth = 5;
+	width = DEF_MAP_WIDTH;
+	height = DEF_MAP_HEIGHT;
+	ncities = DEF_NUM_CITY;
+	level = 0;
+	max_turns = 500;
+	interval = 50;
+	horizon = 0;
+	verbose = FALSE;
+
+	while ((c = getopt (argc, argv, OPTFLAGS)) != EOF) {
+		switch (c) {
+		case 'j': nworkers = atoi (optarg); break;
+		case 'n': ngames = atoi (optarg); break;
+		case 'r': first_seed = atoi (optarg); break;
+		case 'w': water = atoi (optarg); break;
+		case 's': smooth = atoi (optarg); break;
+		case 'W': width = atoi (optarg); break;
+		case 'H': height = atoi (optarg); break;
+		case 'c': ncities = atoi (optarg); break;
+		case 'l': level = atoi (optarg); break;
+		case 't': max_turns = atoi (optarg); break;
+		case 'i': interval = atoi (optarg); break;
+		case 'a': horizon = atoi (optarg); break;
+		case 'v': verbose = TRUE; break;
+		case '?': /* illegal option? */
+			errflg++;
+			break;
+		}
+	}
+	if (errflg || optind != argc || ngames < 0 || max_turns < 1
+		|| interval < 1 || water < 10 || water > 90 || smooth < 0
+		|| width < MIN_MAP_WIDTH || width > MAX_MAP_WIDTH
+		|| height < MIN_MAP_HEIGHT || height > MAX_MAP_HEIGHT
+		|| ncities < MIN_NUM_CITY || ncities > MAX_NUM_CITY
+		|| ncities > width * height / CELLS_PER_CITY
+		|| level < 0 || horizon < 0) {
+		(void) printf ("empire: usage: vms-empire-tourney [-j workers] [-n games] [-r seed]\n");
+		(void) printf ("\t[-w water] [-s smooth] [-W width] [-H height] [-c cities]\n");
+		(void) printf ("\t[-l level] [-t turns] [-i interval] [-a turns] [-v]\n");
+		exit (1);
+	}
+	if (nworkers < 1) nworkers = 1;
+	if (nworkers > MAX_WORKERS) nworkers = MAX_WORKERS;
+	if (nworkers > ngames) nworkers = ngames;
+
+	/* play the games the way 'empire -b' does */
+	batch_turns = max_turns;
+	batch_level = level;
+	plan_horizon = horizon;
+	delay_time = 0;
+
+	(void) fflush (stdout); /* don't let workers inherit output */
+	for (w = 0; w < nworkers; w++) {
+		if (pipe (fds) != 0) {
+			perror ("pipe");
+			exit (1);
+		}
+		worker[w].pid = fork ();
+		if (worker[w].pid < 0) {
+			perror ("fork");
+			exit (1);
+		}
+		if (worker[w].pid == 0) { /* child */
+			(void) close (fds[0]);
+			for (c = 0; c < w; c++) (void) close (worker[c].fd);
+			run_worker (fds[1], w, nworkers);
+		}
+		(void) close (fds[1]);
+		worker[w].fd = fds[0];
+		worker[w].len = 0;
+	}
+
+	open_workers = nworkers;
+	while (open_workers > 0) {
+		FD_ZERO (&readfds);
+		nfds = 0;
+		for (w = 0; w < nworkers; w++)
+		if (worker[w].fd >= 0) {
+			FD_SET (worker[w].fd, &readfds);
+			if (worker[w].fd >= nfds) nfds = worker[w].fd + 1;
+		}
+		if (select (nfds, &readfds, NULL, NULL, NULL) < 0) {
+			perror ("select");
+			exit (1);
+		}
+		for (w = 0; w < nworkers; w++)
+		if (worker[w].fd >= 0 && FD_ISSET (worker[w].fd, &readfds)
+			&& !read_worker (&worker[w])) {
+			(void) close (worker[w].fd);
+			worker[w].fd = -1;
+			open_workers--;
+		}
+	}
+	for (w = 0; w < nworkers; w++)
+		(void) waitpid (worker[w].pid, NULL, 0);
+
+	report ();
+	return (0);
+}
@@ -0,0 +1,130 @@
+/* %W% %G% %U% - (c) Copyright 1987, 1988 Chuck Simmons */
+
+/*
+ *    Copyright (C) 1987, 1988 Chuck Simmons
+ *
+ * See the file COPYING, distributed with empire, for restriction
+ * and warranty information.
+ */
+
+/*
+trace.c -- record a timeline of the game in Chrome trace-event format.
+
+When the game is started with '-t file', 'tracing' is set and the
+interesting parts of each turn are bracketed by 'trace_begin' and
+'trace_end'.  Each span is kept in memory as a complete ("X") event
+with its start time, duration, and up to two named integer arguments
+such as the type and location of the piece being moved.  Nothing is
+written until the game ends, when 'trace_flush' writes the whole
+buffer as a JSON file that can be loaded into a trace viewer.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "empire.h"
+#include "extern.h"
+
+typedef struct {
+	char *name; /* name of span */
+	long start; /* start time in nanoseconds */
+	long dur; /* duration in nanoseconds */
+	char *name1; /* name of first arg, or NULL */
+	long arg1;
+	char *name2; /* name of second arg, or NULL */
+	long arg2;
+} trace_event_t;
+
+static char *trace_file; /* where to write the trace */
+static trace_event_t *trace_buf; /* recorded events */
+static long trace_len; /* number of events recorded */
+static long trace_max; /* number of events buffer can hold */
+static long trace_origin; /* time tracing started */
+
+/*
+Start tracing.  The trace is written to 'file' when the game ends.
+*/
+
+void
+trace_open (file)
+char *file;
+{
+	trace_file = file;
+	trace_len = 0;
+	trace_origin = stats_now ();
+	tracing = TRUE;
+}
+
+/*
+Record a span that began at 'start' and ends now.  Argument names
+must be string constants, as only the pointers are saved.
+*/
+
+void
+trace_span (name, start, name1, arg1, name2, arg2)
+char *name;
+long start;
+char *name1;
+long arg1;
+char *name2;
+long arg2;
+{
+	trace_event_t *ev;
+
+	if (trace_len == trace_max) { /* grow buffer */
+		trace_max = trace_max ? trace_max * 2 : 4096;
+		ev = (trace_event_t *) realloc ((char *)trace_buf,
+				trace_max * sizeof (trace_event_t));
+		if (ev == NULL) { /* out of memory; stop tracing */
+			tracing = FALSE;
+			return;
+		}
+		trace_buf = ev;
+	}
+	ev = &trace_buf[trace_len++];
+	ev->name = name;
+	ev->start = start;
+	ev->dur = stats_now () - start;
+	ev->name1 = name1;
+	ev->arg1 = arg1;
+	ev->name2 = name2;
+	ev->arg2 = arg2;
+}
+
+/*
+Write out the trace.  Times are given in microseconds from the
+moment tracing started.
+*/
+
+void
+trace_flush ()
+{
+	FILE *f;
+	long i, ts;
+	trace_event_t *ev;
+
+	if (trace_file == NULL) return;
+
+	f = fopen (trace_file, "w");
+	if (f == NULL) {
+		perror (trace_file);
+		return;
+	}
+	(void) fprintf (f, "{\"traceEvents\":[\n");
+
+	for (i = 0; i < trace_len; i++) {
+		ev = &trace_buf[i];
+		ts = ev->start - trace_origin;
+		(void) fprintf (f,
+			"{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%ld.%03ld,\"dur\":%ld.%03ld",
+			ev->name, ts / 1000, ts % 1000, ev->dur / 1000, ev->dur % 1000);
+		if (ev->name1) {
+			(void) fprintf (f, ",\"args\":{\"%s\":%ld", ev->name1, ev->arg1);
+			if (ev->name2)
+				(void) fprintf (f, ",\"%s\":%ld", ev->name2, ev->arg2);
+			(void) fprintf (f, "}");
+		}
+		(void) fprintf (f, "}%s\n", i == trace_len - 1 ? "" : ",");
+	}
+	(void) fprintf (f, "],\"displayTimeUnit\":\"ms\"}\n");
+	(void) fclose (f);
+}
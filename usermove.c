@@ -27,43 +27,46 @@ user_move () {
 	int i, j, sec, sec_start;
 	piece_info_t *obj, *next_obj;
 	int prod;
+	long start, span;
 
-	/* First we loop through objects to update the user's view
-	of the world and perform any other necessary processing.
+	start = phase_begin ();
+	span = trace_begin ();
+	stack_enter (ST_USER_MOVE);
+
+	/* First we loop through objects to perform any necessary
+	processing, and we update the user's view of the world.
 	We would like to have the world view up to date before
-	asking the user any questions.  This means that we should
-	also scan through all cities before possibly asking the
-	user what to produce in each city. */
+	asking the user any questions.  This means that the cells
+	around the user's cities are brought up to date as well,
+	before possibly asking the user what to produce in each
+	city. */
 
-	for (i = 0; i < NUM_OBJECTS; i++)
-	for (obj = user_obj[i]; obj != NULL; obj = obj->piece_link.next) {
+	FOR_ALL_PIECES (USER, obj, i)
 		obj->moved = 0; /* nothing moved yet */
-		scan (user_map, obj->loc); /* refresh user's view of world */
-	}
+	scan_changes (USER); /* refresh user's view of world */
 
 	/* produce new hardware */
 	for (i = 0; i < NUM_CITY; i++)
-	    if (city[i].owner == USER) {
-		scan (user_map, city[i].loc);
-		prod = city[i].prod;
+	    if (game->city[i].owner == USER) {
+		prod = game->city[i].prod;
 
 		if (prod == NOPIECE) { /* need production? */
-			set_prod (&(city[i])); /* ask user what to produce */
+			set_prod (&(game->city[i])); /* ask user what to produce */
 		}
-		else if (city[i].work++ >= (long)piece_attr[prod].build_time) {
+		else if (game->city[i].work++ >= (long)piece_attr[prod].build_time) {
 				/* kermyt begin */
-			ksend1("%s has been completed at city %d.\n", piece_attr[prod].article,city[i].loc,0,0,0,0,0,0);
+			ksend1("%s has been completed at city %d.\n", piece_attr[prod].article,game->city[i].loc,0,0,0,0,0,0);
 				/* kermyt end */
-			comment1 ("%s has been completed at city %d.\n", piece_attr[prod].article,city[i].loc,0,0,0,0,0,0);
+			comment1 ("%s has been completed at city %d.\n", piece_attr[prod].article,game->city[i].loc,0,0,0,0,0,0);
 
-			produce (&city[i]);
+			produce (&game->city[i]);
 			/* produce should set object.moved to 0 */
 		}
 	}
 
 	/* move all satellites */
-	for (obj = user_obj[SATELLITE]; obj != NULL; obj = next_obj) {
-		next_obj = obj->piece_link.next;
+	for (obj = OBJ(user_obj[SATELLITE]); obj != NULL; obj = next_obj) {
+		next_obj = OBJ(LINKS(obj)->piece_link.next);
 		move_sat (obj);
 	}
 	
@@ -76,12 +79,11 @@ user_move () {
 		sector_change (); /* allow screen to be redrawn */
 
 		for (j = 0; j < NUM_OBJECTS; j++) /* loop through obj lists */
-		for (obj = user_obj[move_order[j]]; obj != NULL;
-			obj = next_obj) { /* loop through objs in list */
-			next_obj = obj->piece_link.next;
+		for (obj = OBJ(game->sector_obj[sec][move_order[j]]);
+			obj != NULL; obj = next_obj) { /* loop through objs in sector */
+			next_obj = OBJ(game->sector_next[obj->ref - 1]);
 
 			if (!obj->moved) /* object not moved yet? */
-			if (loc_sector (obj->loc) == sec) /* object in sector? */
 			piece_move (obj); /* yup; move the object */
 		}
 		if (cur_sector () == sec) { /* is sector displayed? */
@@ -90,6 +92,8 @@ user_move () {
 		}
 	}
 	if (save_movie) save_movie_screen ();
+	phase_end (PH_USER_MOVE, start);
+	trace_end ("user_move", span, NULL, 0, NULL, 0);
 }
 
 /*
@@ -119,7 +123,7 @@ piece_info_t *obj;
 	cityp = find_city (obj->loc);
 	if (cityp != NULL)
 		if (cityp->func[obj->type] != NOFUNC)
-			obj->func = cityp->func[obj->type];
+			set_func (obj, cityp->func[obj->type]);
 
 	changed_loc = FALSE; /* not changed yet */
 	speed = piece_attr[obj->type].speed;
@@ -177,7 +181,7 @@ piece_info_t *obj;
 			&& obj->moved > 0) {
 				obj->range = piece_attr[FIGHTER].range;
 				obj->moved = speed;
-				obj->func = NOFUNC;
+				set_func (obj, NOFUNC);
 				comment ("Landing confirmed.",0,0,0,0,0,0,0,0);
 			}
 			else if (obj->range == 0) {
@@ -193,8 +197,11 @@ piece_info_t *obj;
 		&& !changed_loc /* object never changed location? */
 		&& obj->type != ARMY && obj->type != FIGHTER /* it is a boat? */
 		&& obj->hits < max_hits /* it is damaged? */
-		&& user_map[obj->loc].contents == 'O') /* it is in port? */
-	obj->hits++; /* fix some damage */
+		&& user_map[obj->loc].contents == 'O') { /* it is in port? */
+		hash_piece (obj);
+		obj->hits++; /* fix some damage */
+		hash_piece (obj);
+	}
 }
 
 /*
@@ -233,32 +240,32 @@ territory.
 void move_explore (obj)
 piece_info_t *obj;
 {
-	path_map_t path_map[MAP_SIZE];
 	long loc;
 	char *terrain;
 
+	stack_enter (ST_MOVE_EXPLORE);
 	switch (obj->type) {
 	case ARMY:
-		loc = vmap_find_lobj (path_map, user_map, obj->loc, &user_army);
+		loc = vmap_find_lobj (game->path_map, user_map, obj->loc, &user_army);
 		terrain = "+";
 		break;
 	case FIGHTER:
-		loc = vmap_find_aobj (path_map, user_map, obj->loc, &user_fighter);
+		loc = vmap_find_aobj (game->path_map, user_map, obj->loc, &user_fighter);
 		terrain = "+.O";
 		break;
 	default:
-		loc = vmap_find_wobj (path_map, user_map, obj->loc, &user_ship);
+		loc = vmap_find_wobj (game->path_map, user_map, obj->loc, &user_ship);
 		terrain = ".O";
 		break;
 	}
 	
 	if (loc == obj->loc) return; /* nothing to explore */
 
-	if (user_map[loc].contents == ' ' && path_map[loc].cost == 2)
-		vmap_mark_adjacent (path_map, obj->loc);
-	else vmap_mark_path (path_map, user_map, loc);
+	if (user_map[loc].contents == ' ' && game->path_map[loc].cost == 2)
+		vmap_mark_adjacent (game->path_map, obj->loc);
+	else vmap_mark_path (game->path_map, user_map, loc);
 
-	loc = vmap_find_dir (path_map, user_map, obj->loc, terrain, " ");
+	loc = vmap_find_dir (game->path_map, user_map, obj->loc, terrain, " ");
 	if (loc != obj->loc) move_obj (obj, loc);
 }
 
@@ -279,7 +286,7 @@ piece_info_t *obj;
 	
 	if (loc != obj->loc) {
 		move_obj (obj, loc);
-		obj->func = NOFUNC;
+		set_func (obj, NOFUNC);
 	}
 	else obj->moved = piece_attr[obj->type].speed;
 }
@@ -290,7 +297,7 @@ If there is an adjacent transport, move the army onto
 the transport, and awaken the army.
 */
 
-static view_map_t amap[MAP_SIZE];
+#define amap (game->amap) /* temp view map */
 
 void
 move_armyload (obj)
@@ -307,19 +314,19 @@ piece_info_t *obj;
 
 	if (loc != obj->loc) {
 		move_obj (obj, loc);
-		obj->func = NOFUNC;
+		set_func (obj, NOFUNC);
 	}
 	else { /* look for nearest non-full transport */
 		(void) memcpy (amap, user_map, sizeof (view_map_t) * MAP_SIZE);
 
 		/* mark loading transports or cities building transports */
-		for (p = user_obj[TRANSPORT]; p; p = p->piece_link.next)
-		if (p->count < obj_capacity (p)) /* not full? */
+		for (p = OBJ(user_obj[TRANSPORT]); p; p = OBJ(LINKS(p)->piece_link.next))
+		if (LINKS(p)->count < obj_capacity (p)) /* not full? */
 		amap[p->loc].contents = '$';
 		
 		for (i = 0; i < NUM_CITY; i++)
-		if (city[i].owner == USER && city[i].prod == TRANSPORT)
-		amap[city[i].loc].contents = '$';
+		if (game->city[i].owner == USER && game->city[i].prod == TRANSPORT)
+		amap[game->city[i].loc].contents = '$';
 	}
 }
 		
@@ -331,18 +338,17 @@ void
 move_armyattack (obj)
 piece_info_t *obj;
 {
-	path_map_t path_map[MAP_SIZE];
 	long loc;
 
 	ASSERT (obj->type == ARMY);
 
-	loc = vmap_find_lobj (path_map, user_map, obj->loc, &user_army_attack);
+	loc = vmap_find_lobj (game->path_map, user_map, obj->loc, &user_army_attack);
 	
 	if (loc == obj->loc) return; /* nothing to attack */
 
-	vmap_mark_path (path_map, user_map, loc);
+	vmap_mark_path (game->path_map, user_map, loc);
 
-	loc = vmap_find_dir (path_map, user_map, obj->loc, "+", "X*a");
+	loc = vmap_find_dir (game->path_map, user_map, obj->loc, "+", "X*a");
 	if (loc != obj->loc) move_obj (obj, loc);
 }
 
@@ -362,13 +368,12 @@ void
 move_repair (obj)
 piece_info_t *obj;
 {
-	path_map_t path_map[MAP_SIZE];
 	long loc;
 
 	ASSERT (obj->type > FIGHTER);
 	
 	if (obj->hits == piece_attr[obj->type].max_hits) {
-		obj->func = NOFUNC;
+		set_func (obj, NOFUNC);
 		return;
 	}
 	
@@ -377,14 +382,14 @@ piece_info_t *obj;
 		return;
 	}
 
-	loc = vmap_find_wobj (path_map, user_map, obj->loc, &user_ship_repair);
+	loc = vmap_find_wobj (game->path_map, user_map, obj->loc, &user_ship_repair);
 	
 	if (loc == obj->loc) return; /* no reachable city */
 
-	vmap_mark_path (path_map, user_map, loc);
+	vmap_mark_path (game->path_map, user_map, loc);
 
 	/* try to be next to ocean to avoid enemy pieces */
-	loc = vmap_find_dir (path_map, user_map, obj->loc, ".O", ".");
+	loc = vmap_find_dir (game->path_map, user_map, obj->loc, ".O", ".");
 	if (loc != obj->loc) move_obj (obj, loc);
 }
 
@@ -397,8 +402,8 @@ Otherwise we awaken the object.
 void move_fill (obj)
 piece_info_t *obj;
 {
-	if (obj->count == obj_capacity (obj)) /* full? */
-		obj->func = NOFUNC; /* awaken full boat */
+	if (LINKS(obj)->count == obj_capacity (obj)) /* full? */
+		set_func (obj, NOFUNC); /* awaken full boat */
 	else obj->moved = piece_attr[obj->type].speed;
 }
 
@@ -419,7 +424,7 @@ piece_info_t *obj;
 
 	best_dist = find_nearest_city (obj->loc, USER, &best_loc);
 
-	for (p = user_obj[CARRIER]; p != NULL; p = p->piece_link.next) {
+	for (p = OBJ(user_obj[CARRIER]); p != NULL; p = OBJ(LINKS(p)->piece_link.next)) {
 		new_dist = dist (obj->loc, p->loc);
 		if (new_dist < best_dist) {
 			best_dist = new_dist;
@@ -431,7 +436,7 @@ piece_info_t *obj;
 	else if (best_dist <= obj->range)
 		move_to_dest (obj, best_loc);
 		
-	else obj->func = NOFUNC; /* can't reach city or carrier */
+	else set_func (obj, NOFUNC); /* can't reach city or carrier */
 }
 
 /*
@@ -464,7 +469,7 @@ void move_path (obj)
 piece_info_t *obj;
 {
 	if (obj->loc == obj->func)
-		obj->func = NOFUNC;
+		set_func (obj, NOFUNC);
 	else move_to_dest (obj, obj->func);
 }
 
@@ -479,11 +484,11 @@ void move_to_dest (obj, dest)
 piece_info_t *obj;
 long dest;
 {
-	path_map_t path_map[MAP_SIZE];
 	int fterrain;
 	char *mterrain;
 	long new_loc;
 	
+	stack_enter (ST_MOVE_TO_DEST);
 	switch (obj->type) {
 	case ARMY:
 		fterrain = T_LAND;
@@ -499,12 +504,12 @@ long dest;
 		break;
 	}
 	
-	new_loc = vmap_find_dest (path_map, user_map, obj->loc, dest,
+	new_loc = vmap_find_dest (game->path_map, user_map, obj->loc, dest,
                                   USER, fterrain);
 	if (new_loc == obj->loc) return; /* can't get there */
 	
-	vmap_mark_path (path_map, user_map, dest);
-	new_loc = vmap_find_dir (path_map, user_map, obj->loc, mterrain, " .");
+	vmap_mark_path (game->path_map, user_map, dest);
+	new_loc = vmap_find_dir (game->path_map, user_map, obj->loc, mterrain, " .");
 	if (new_loc == obj->loc) return; /* can't move ahead */
 	ASSERT (good_loc (obj, new_loc));
 	move_obj (obj, new_loc); /* everything looks good */
@@ -587,7 +592,7 @@ piece_info_t *obj;
 
 	if (cityp != NULL)
 	if (cityp->func[obj->type] != NOFUNC) {
-		obj->func = cityp->func[obj->type];
+		set_func (obj, cityp->func[obj->type]);
 		(void) awake (obj);
 	} 
 }
@@ -617,7 +622,7 @@ user_fill (obj)
 piece_info_t *obj;
 {
 	if (obj->type != TRANSPORT && obj->type != CARRIER) (void) beep ();
-	else obj->func = FILL;
+	else set_func (obj, FILL);
 }
 
 /*
@@ -646,14 +651,14 @@ piece_info_t *obj;
 
 	c = get_chx ();
 	switch (c) {
-	case 'Q': obj->func = MOVE_NW; break;
-	case 'W': obj->func = MOVE_N ; break;
-	case 'E': obj->func = MOVE_NE; break;
-	case 'D': obj->func = MOVE_E ; break;
-	case 'C': obj->func = MOVE_SE; break;
-	case 'X': obj->func = MOVE_S ; break;
-	case 'Z': obj->func = MOVE_SW; break;
-	case 'A': obj->func = MOVE_W ; break;
+	case 'Q': set_func (obj, MOVE_NW); break;
+	case 'W': set_func (obj, MOVE_N ); break;
+	case 'E': set_func (obj, MOVE_NE); break;
+	case 'D': set_func (obj, MOVE_E ); break;
+	case 'C': set_func (obj, MOVE_SE); break;
+	case 'X': set_func (obj, MOVE_S ); break;
+	case 'Z': set_func (obj, MOVE_SW); break;
+	case 'A': set_func (obj, MOVE_W ); break;
 	default: (void) beep (); break;
 	}
 }
@@ -666,7 +671,7 @@ void
 user_wake (obj)
 piece_info_t *obj;
 {
-	obj->func = NOFUNC;
+	set_func (obj, NOFUNC);
 }
 
 /*
@@ -677,7 +682,7 @@ void
 user_random (obj)
 piece_info_t *obj;
 {
-	obj->func = RANDOM;
+	set_func (obj, RANDOM);
 }
 
 /*
@@ -688,7 +693,7 @@ void
 user_sentry (obj)
 piece_info_t *obj;
 {
-	obj->func = SENTRY;
+	set_func (obj, SENTRY);
 }
 
 /*
@@ -700,7 +705,7 @@ user_land (obj)
 piece_info_t *obj;
 {
 	if (obj->type != FIGHTER) (void) beep ();
-	else obj->func = LAND;
+	else set_func (obj, LAND);
 }
 
 /*
@@ -711,7 +716,7 @@ void
 user_explore (obj)
 piece_info_t *obj;
 {
-	obj->func = EXPLORE;
+	set_func (obj, EXPLORE);
 }
 
 /*
@@ -723,7 +728,7 @@ user_transport (obj)
 piece_info_t *obj;
 {
 	if (obj->type != ARMY) (void) beep ();
-	else obj->func = WFTRANSPORT;
+	else set_func (obj, WFTRANSPORT);
 }
 
 /*
@@ -735,7 +740,7 @@ user_armyattack (obj)
 piece_info_t *obj;
 {
 	if (obj->type != ARMY) (void) beep ();
-	else obj->func = ARMYATTACK;
+	else set_func (obj, ARMYATTACK);
 }
 
 /*
@@ -747,7 +752,7 @@ user_repair (obj)
 piece_info_t *obj;
 {
 	if (obj->type == ARMY || obj->type == FIGHTER) (void) beep ();
-	else obj->func = REPAIR;
+	else set_func (obj, REPAIR);
 }
 
 /*
@@ -847,7 +852,7 @@ int dir;
 		move_obj (obj, loc);
 		return;
 	}
-	if (!map[loc].on_board) {
+	if (!ON_BOARD (loc)) {
 		error ("You cannot move to the edge of the world.",0,0,0,0,0,0,0,0);
 		delay ();
 		return;
@@ -882,7 +887,7 @@ long loc;
 	"Sorry, sir.  There is no more room on the transport.  Do you insist? ",
 	"Your army jumped into the briny and drowned.");
 
-	else if (map[loc].contents == '.') { /* going for a swim? */
+	else if (game->map[loc].contents == '.') { /* going for a swim? */
 		if (!getyn ( /* thanks to Craig Hansen for this next message */
 	"Troops can't walk on water, sir.  Do you really want to go to sea? "))
 		return;
@@ -935,7 +940,7 @@ user_dir_fighter (obj, loc)
 piece_info_t *obj;
 long loc;
 {
-	if (map[loc].contents == '*')
+	if (game->map[loc].contents == '*')
 		fatal (obj, loc,
 	"That's never worked before, sir.  Do you really want to try? ",
 	"Your fighter was shot down.");
@@ -966,7 +971,7 @@ long loc;
 
 	enemy_killed = FALSE;
 
-	if (map[loc].contents == '*') {
+	if (game->map[loc].contents == '*') {
 		(void) sprintf (jnkbuf, "Your %s broke up on shore.",
 				piece_attr[obj->type].name);
 
@@ -975,7 +980,7 @@ long loc;
 			jnkbuf);
 	}
 
-	else if (map[loc].contents == '+') { /* moving ashore? */
+	else if (game->map[loc].contents == '+') { /* moving ashore? */
 		if (!getyn ("Ships need sea to float, sir.  Do you really want to go ashore? ")) return;
 
 		if (user_map[loc].contents == '+')
@@ -1082,14 +1087,14 @@ piece_info_t *obj;
 	    && obj->func != LAND /* that aren't returning to base */
 	    && obj->func < 0 /* and which don't have a path */
 	    && obj->range <= find_nearest_city (obj->loc, USER, &t) + 2) {
-		obj->func = NOFUNC; /* wake piece */
+		set_func (obj, NOFUNC); /* wake piece */
 		return (TRUE);
 	}
 	for (i = 0; i < 8; i++) { /* for each surrounding cell */
 		c = user_map[obj->loc+dir_offset[i]].contents;
 
 		if (islower (c) || c == '*' || c == 'X') {
-			if (obj->func < 0) obj->func = NOFUNC; /* awaken */
+			if (obj->func < 0) set_func (obj, NOFUNC); /* awaken */
 			return (TRUE);
 		}
 	}
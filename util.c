@@ -72,6 +72,17 @@ ttinit()
 #ifdef A_COLOR
 	init_colors();
 #endif /* A_COLOR */
+	fit_screen ();
+}
+
+/*
+Use no more of the screen than the map needs.  This is done again
+whenever a game is made or restored, since the map may change size.
+*/
+
+void
+fit_screen ()
+{
 	lines = LINES;
 	cols = COLS;
 	if (lines > MAP_HEIGHT + NUMTOPS + 1)
@@ -219,6 +230,7 @@ void
 empend ()
 {
 	close_disp ();
+	trace_flush ();
 	exit (0);
 }
 
@@ -258,22 +270,70 @@ objects on the map have non-zero hits.
 
 6)  Make sure every object with a ship pointer is in that ship's
 cargo list.
+
+Looking at everything takes time in proportion to the size of the
+object pool and the map, so 'check' is run only every 'check_interval'
+turns.  After every scan, 'check_recent' looks at just the pieces and
+cells that have changed since the last check.
+
+A problem is not fatal.  We report it, with the number of the piece
+and the location concerned, and go on; a list that loops or holds a
+bad reference is not followed any further.
 */
 
-static int in_free[LIST_SIZE]; /* TRUE if object in free list */
-static int in_obj[LIST_SIZE]; /* TRUE if object in obj list */
-static int in_loc[LIST_SIZE]; /* TRUE if object in a loc list */
-static int in_cargo[LIST_SIZE]; /* TRUE if object in a cargo list */
+#define in_free (game->in_free) /* TRUE if object in free list */
+#define in_obj (game->in_obj) /* TRUE if object in obj list */
+#define in_loc (game->in_loc) /* TRUE if object in a loc list */
+#define in_cargo (game->in_cargo) /* TRUE if object in a cargo list */
+
+#define BAD_REF(r) ((r) < 0 || (r) > pool_size)
+
+/* report a problem with piece 'ref' (or 0) at 'loc' (or -1) unless 'x' */
+#define CHECK(x,ref,loc) if (!(x)) check_fail (__LINE__, (long)(ref), (long)(loc))
+
+/* TRUE if we can go on to piece 'r' in a list; 'seen' marks where we have been */
+#define FOLLOW(r,seen,loc) (BAD_REF (r) || (seen)[(r)-1] \
+	? (check_fail (__LINE__, (long)(r), (long)(loc)), FALSE) \
+	: ((seen)[(r)-1] = 1, TRUE))
+
+/* TRUE if the piece before 'p' in a list points back at it */
+#define LINKED(p,list) (LINKS(p)->list.prev == 0 \
+	|| !BAD_REF (LINKS(p)->list.prev) \
+	&& REF_LINKS(LINKS(p)->list.prev)->list.next == (p)->ref)
+
+/*
+Report a problem.  Problems are appended to 'empcheck.dat', as there
+may be no screen to show them on.
+*/
+
+static void
+check_fail (line, ref, loc)
+int line;
+long ref;
+long loc;
+{
+	FILE *f;
+
+	if (check_errors++ == 0)
+		error ("Consistency check failed; see empcheck.dat.",0,0,0,0,0,0,0,0);
+
+	f = fopen ("empcheck.dat", "a"); /* open for append */
+	if (f == NULL) return;
+	(void) fprintf (f, "date %ld: util.c line %d: piece %ld at %ld\n",
+		game->date, line, ref, loc);
+	(void) fclose (f);
+}
 
 void
 check () {
-	void check_cargo(), check_obj(), check_obj_cargo();
+	void check_cargo(), check_obj(), forget_recent();
 	
-	long i, j;
+	long i, j, k;
+	int r;
 	piece_info_t *p;
 	
 	/* nothing in any list yet */
-	for (i = 0; i < LIST_SIZE; i++) {
+	for (i = 0; i < pool_size; i++) {
 		in_free[i] = 0;
 		in_obj[i] = 0;
 		in_loc[i] = 0;
@@ -283,13 +343,10 @@ check () {
 	/* Mark all objects in free list.  Make sure objects in free list
 	have zero hits. */
 	
-	for (p = free_list; p != NULL; p = p->piece_link.next) {
-		i = p - object;
-		ASSERT (!in_free[i]);
-		in_free[i] = 1;
-		ASSERT (p->hits == 0);
-		if (p->piece_link.prev)
-			ASSERT (p->piece_link.prev->piece_link.next == p);
+	for (r = free_list; r && FOLLOW (r, in_free, -1); r = LINKS(p)->piece_link.next) {
+		p = OBJ(r);
+		CHECK (p->hits == 0, r, p->loc);
+		CHECK (LINKED (p, piece_link), r, p->loc);
 	}
 	
 	/* Mark all objects in the map.
@@ -298,26 +355,43 @@ check () {
 	have a good owner, and good hits. */
 	
 	for (i = 0; i < MAP_SIZE; i++) {
-		if (map[i].cityp) ASSERT (map[i].cityp->loc == i);
+		if (game->map[i].cityp)
+			CHECK (game->map[i].cityp <= NUM_CITY
+				&& CITY(game->map[i].cityp)->loc == i, 0, i);
 		
-		for (p = map[i].objp; p != NULL; p = p->loc_link.next) {
-			ASSERT (p->loc == i);
-			ASSERT (p->hits > 0);
-			ASSERT (p->owner == USER || p->owner == COMP);
-				
-			j = p - object;
-			ASSERT (!in_loc[j]);
-			in_loc[j] = 1;
-			
-			if (p->loc_link.prev)
-				ASSERT (p->loc_link.prev->loc_link.next == p);
+		for (r = game->map[i].objp; r && FOLLOW (r, in_loc, i); r = LINKS(p)->loc_link.next) {
+			p = OBJ(r);
+			CHECK (p->loc == i, r, i);
+			CHECK (p->hits > 0, r, i);
+			CHECK (p->owner == USER || p->owner == COMP, r, i);
+			CHECK (LINKED (p, loc_link), r, i);
 		}
 	}
 
 	/* make sure all cities are on map */
 
 	for (i = 0; i < NUM_CITY; i++)
-		ASSERT (map[city[i].loc].cityp == &(city[i]));
+		CHECK (game->city[i].loc >= 0 && game->city[i].loc < MAP_SIZE
+			&& game->map[game->city[i].loc].cityp == CITY_REF (&game->city[i]),
+			0, game->city[i].loc);
+
+	/* make sure each city is on the grid once, in the right list */
+
+	j = 0;
+	for (i = 0; i < NUM_OWNERS * game->grid_rows * game->grid_cols; i++) {
+		for (k = game->city_grid[i]; k && j <= NUM_CITY; k = game->city_next[k-1]) {
+			if (k < 0 || k > NUM_CITY) {
+				check_fail (__LINE__, 0L, -1L);
+				break;
+			}
+			CHECK (game->city[k-1].owner * game->grid_rows * game->grid_cols
+				+ loc_row (game->city[k-1].loc) / CITY_GRID * game->grid_cols
+				+ loc_col (game->city[k-1].loc) / CITY_GRID == i,
+				0, game->city[k-1].loc);
+			j++;
+		}
+	}
+	CHECK (j == NUM_CITY, 0, -1);
 
 	/* Scan object lists. */
 	
@@ -326,20 +400,28 @@ check () {
 	
 	/* Scan cargo lists. */
 	
-	check_cargo (user_obj[TRANSPORT], ARMY);
-	check_cargo (comp_obj[TRANSPORT], ARMY);
-	check_cargo (user_obj[CARRIER], FIGHTER);
-	check_cargo (comp_obj[CARRIER], FIGHTER);
+	check_cargo ();
 	
-	/* Make sure all objects with ship pointers are in cargo. */
+	/* Make sure all objects with ship pointers are in cargo, and
+	every object is either free or in loc and obj list. */
+
+	for (i = 0; i < pool_size; i++) {
+		p = POOL_OBJ (i);
+		CHECK (p->ref == i + 1, i + 1, -1);
+		CHECK (in_free[i] != (in_loc[i] && in_obj[i]), i + 1, p->loc);
+		if (in_obj[i] && LINKS(p)->ship)
+			CHECK (in_cargo[i], i + 1, p->loc);
+	}
 
-	check_obj_cargo (comp_obj);
-	check_obj_cargo (user_obj);
-	
-	/* Make sure every object is either free or in loc and obj list. */
+	/* Make sure the dense index holds just the live pieces. */
 
-	for (i = 0; i < LIST_SIZE; i++)
-		ASSERT (in_free[i] != (in_loc[i] && in_obj[i]));
+	CHECK (vec_start[0] == 0 && vec_start[NUM_GROUPS] == obj_used, 0, -1);
+
+	/* Make sure the hash has followed every change to a piece. */
+
+	CHECK (hash_pieces () == game->piece_hash, 0, -1);
+
+	forget_recent (); /* we have looked at everything */
 }
 
 /*
@@ -352,35 +434,43 @@ Check object lists.  We look for:
 3)  Invalid types.
 
 4)  Invalid owners.
+
+5)  Pieces that are not in their group of the dense index, and groups
+    that hold more or fewer pieces than the list.
 */
 
 void
 check_obj (list, owner)
-piece_info_t **list;
+int *list;
 int owner;
 {
 	long i, j;
+	int count, g, r;
 	piece_info_t *p;
 	
-	for (i = 0; i < NUM_OBJECTS; i++)
-	for (p = list[i]; p != NULL; p = p->piece_link.next) {
-		ASSERT (p->owner == owner);
-		ASSERT (p->type == i);
-		ASSERT (p->hits > 0);
+	for (i = 0; i < NUM_OBJECTS; i++) {
+		g = VEC_GROUP (owner, i);
+		count = 0;
+		for (r = list[i]; r && FOLLOW (r, in_obj, -1); r = LINKS(p)->piece_link.next) {
+			p = OBJ(r);
+			CHECK (p->owner == owner, r, p->loc);
+			CHECK (p->type == i, r, p->loc);
+			CHECK (p->hits > 0, r, p->loc);
+			CHECK (LINKED (p, piece_link), r, p->loc);
 		
-		j = p - object;
-		ASSERT (!in_obj[j]);
-		in_obj[j] = 1;
-	
-		if (p->piece_link.prev)
-			ASSERT (p->piece_link.prev->piece_link.next == p);
+			j = r - 1;
+			CHECK (vec_pos[j] >= vec_start[g] && vec_pos[j] < vec_start[g+1]
+				&& piece_vec[vec_pos[j]] == j, r, p->loc);
+			count++;
+		}
+		CHECK (count == vec_start[g+1] - vec_start[g], 0, -1);
 	}
 }
 
 /*
 Check cargo lists.  We assume object lists are valid.
 as we will place bits in the 'in_cargo' array that are used by
-'check_obj'.
+'check'.
 
 Check for:
 
@@ -398,49 +488,224 @@ Check for:
 */
 
 void
-check_cargo (list, cargo_type)
-piece_info_t *list;
-int cargo_type;
+check_cargo ()
 {
 	piece_info_t *p, *q;
-	long j, count;
+	long i, count;
+	int r, cargo_type;
 	
-	for (p = list; p != NULL; p = p->piece_link.next) {
+	for (i = 0; i < pool_size; i++) {
+		p = POOL_OBJ (i);
+		if (!in_obj[i]) continue;
+		if (p->type == TRANSPORT) cargo_type = ARMY;
+		else if (p->type == CARRIER) cargo_type = FIGHTER;
+		else continue;
+
 		count = 0;
-		for (q = p->cargo; q != NULL; q = q->cargo_link.next) {
+		for (r = LINKS(p)->cargo; r && FOLLOW (r, in_cargo, p->loc); r = LINKS(q)->cargo_link.next) {
+			q = OBJ(r);
 			count += 1; /* count items in list */
-			ASSERT (q->type == cargo_type);
-			ASSERT (q->owner == p->owner);
-			ASSERT (q->hits > 0);
-			ASSERT (q->ship == p);
-			ASSERT (q->loc == p->loc);
-			
-			j = q - object;
-			ASSERT (!in_cargo[j]);
-			in_cargo[j] = 1;
-
-			if (p->cargo_link.prev)
-				ASSERT (p->cargo_link.prev->cargo_link.next == p);
-                }
-		ASSERT (count == p->count);
-        }
+			CHECK (q->type == cargo_type, r, q->loc);
+			CHECK (q->owner == p->owner, r, q->loc);
+			CHECK (q->hits > 0, r, q->loc);
+			CHECK (LINKS(q)->ship == p->ref, r, q->loc);
+			CHECK (q->loc == p->loc, r, q->loc);
+			CHECK (LINKED (q, cargo_link), r, q->loc);
+		}
+		CHECK (count == LINKS(p)->count, p->ref, p->loc);
+	}
 }
 
 /*
-Scan through object lists making sure every object with a ship
-pointer appears in a cargo list.  We assume object and cargo
-lists are valid.
+Note that a piece has changed, so that check_recent looks at it.
+Every change to a piece is hashed (see hash.c), so hash_piece calls
+us when we are checking.
 */
 
 void
-check_obj_cargo (list)
-piece_info_t **list;
+touch_piece (obj)
+piece_info_t *obj;
+{
+	if (!game->touched[obj->ref - 1]) {
+		game->touched[obj->ref - 1] = TRUE;
+		game->touch_list[game->ntouched++] = obj->ref;
+	}
+}
+
+/*
+Forget the pieces and cells that have changed.
+*/
+
+void
+forget_recent ()
 {
-	piece_info_t *p;
 	long i;
+	int *list;
+
+	for (i = 0; i < game->ntouched; i++)
+		game->touched[game->touch_list[i] - 1] = FALSE;
+	game->ntouched = 0;
+
+	list = game->changes[UNOWNED];
+	for (i = 0; i < game->nchanged[UNOWNED]; i++)
+		game->changed[list[i]] &= ~(1 << UNOWNED);
+	game->nchanged[UNOWNED] = 0;
+}
+
+/*
+Check one piece that has changed.  A live piece must be where its
+lists say it is, on a ship that carries it, and in its place in the
+dense index and, for the user, the list for its sector; a dead piece
+must be on the free list and no longer on the map.  A piece at the
+head of a list is checked against the head rather than by walking
+the list.
+*/
+
+static void
+check_piece (p)
+piece_info_t *p;
+{
+	piece_info_t *q;
+	long count;
+	int r, s, g;
+
+	r = p->ref;
+	if (p->hits == 0) { /* free */
+		CHECK (LINKED (p, piece_link), r, p->loc);
+		CHECK (LINKS(p)->piece_link.prev || free_list == r, r, p->loc);
+		CHECK (LINKS(p)->loc_link.prev == 0 && LINKS(p)->loc_link.next == 0
+			&& (p->loc < 0 || p->loc >= MAP_SIZE
+			 || game->map[p->loc].objp != r), r, p->loc);
+		return;
+	}
+	if (p->owner != USER && p->owner != COMP
+	 || p->type < 0 || p->type >= NUM_OBJECTS
+	 || p->loc < 0 || p->loc >= MAP_SIZE || !game->map[p->loc].on_board) {
+		check_fail (__LINE__, (long)r, (long)p->loc);
+		return;
+	}
+	CHECK (LINKED (p, piece_link), r, p->loc);
+	CHECK (LINKS(p)->piece_link.prev || LIST(p->owner)[p->type] == r,
+		r, p->loc);
+	CHECK (LINKED (p, loc_link), r, p->loc);
+	CHECK (LINKS(p)->loc_link.prev || game->map[p->loc].objp == r, r, p->loc);
+
+	g = VEC_GROUP (p->owner, p->type);
+	CHECK (vec_pos[r-1] >= vec_start[g] && vec_pos[r-1] < vec_start[g+1]
+		&& piece_vec[vec_pos[r-1]] == r-1, r, p->loc);
+
+	if (p->owner == USER) { /* in order on its sector's list */
+		s = game->sector_prev[r-1];
+		if (BAD_REF (s)) check_fail (__LINE__, (long)r, (long)p->loc);
+		else CHECK (s ? game->sector_next[s-1] == r
+				&& game->list_seq[s-1] > game->list_seq[r-1]
+			: game->sector_obj[loc_sector (p->loc)][p->type] == r,
+			r, p->loc);
+	}
+
+	s = LINKS(p)->ship;
+	if (BAD_REF (s)) check_fail (__LINE__, (long)r, (long)p->loc);
+	else if (s) {
+		q = OBJ(s);
+		CHECK (q->hits > 0 && q->owner == p->owner && q->loc == p->loc
+			&& q->type == (p->type == ARMY ? TRANSPORT : CARRIER),
+			r, p->loc);
+		CHECK (LINKED (p, cargo_link), r, p->loc);
+		CHECK (LINKS(p)->cargo_link.prev || LINKS(q)->cargo == r,
+			r, p->loc);
+	}
+
+	count = 0;
+	for (s = LINKS(p)->cargo; s; s = LINKS(q)->cargo_link.next) {
+		if (BAD_REF (s) || count > pool_size) {
+			check_fail (__LINE__, (long)r, (long)p->loc);
+			break;
+		}
+		q = OBJ(s);
+		CHECK (LINKS(q)->ship == r && q->loc == p->loc && q->hits > 0,
+			s, p->loc);
+		count++;
+	}
+	CHECK (count == LINKS(p)->count, r, p->loc);
+}
+
+/*
+Check one cell that has changed: its city, the pieces in it, and
+its occupancy.
+*/
+
+static void
+check_cell (loc)
+long loc;
+{
+	piece_info_t *p, *best;
+	long count;
+	int r, k, types, owners;
+
+	r = game->map[loc].cityp;
+	if (r < 0 || r > NUM_CITY) check_fail (__LINE__, 0L, loc);
+	else if (r) {
+		CHECK (game->city[r-1].loc == loc, 0, loc);
+
+		/* look for the city in its square of the grid */
+		count = 0;
+		k = game->city_grid[game->city[r-1].owner * game->grid_rows * game->grid_cols
+			+ loc_row (loc) / CITY_GRID * game->grid_cols
+			+ loc_col (loc) / CITY_GRID];
+		while (k > 0 && k <= NUM_CITY && k != r && count++ < NUM_CITY)
+			k = game->city_next[k-1];
+		CHECK (k == r, 0, loc);
+	}
+
+	count = 0;
+	types = 0;
+	owners = 0;
+	best = OBJ(game->map[loc].objp);
+	for (r = game->map[loc].objp; r; r = LINKS(p)->loc_link.next) {
+		if (BAD_REF (r) || count++ > pool_size) {
+			check_fail (__LINE__, (long)r, loc);
+			return;
+		}
+		p = OBJ(r);
+		CHECK (p->loc == loc && p->hits > 0, r, loc);
+		CHECK (p->owner == USER || p->owner == COMP, r, loc);
+		CHECK (LINKED (p, loc_link), r, loc);
+		types |= 1 << p->type;
+		owners |= 1 << p->owner;
+		if (p->type > best->type && p->type != SATELLITE) best = p;
+	}
+	CHECK (occupancy[loc].top == OBJ_REF (best), 0, loc);
+	CHECK (occupancy[loc].types == types, 0, loc);
+	CHECK (occupancy[loc].count == count, 0, loc);
+	CHECK (occupancy[loc].owners == owners, 0, loc);
+}
+
+/*
+Check the pieces and cells that have changed since the last check.
+This takes time in proportion to the number of changes, so it can be
+done after every scan.  A piece or cell dropped since the change (as
+when a new game is made) is passed over.
+*/
+
+void
+check_recent ()
+{
+	long i, loc;
+	int r;
+	int *list;
+
+	for (i = 0; i < game->ntouched; i++) {
+		r = game->touch_list[i];
+		game->touched[r-1] = FALSE;
+		if (r <= pool_size) check_piece (POOL_OBJ (r-1));
+	}
+	game->ntouched = 0;
 
-	for (i = 0; i < NUM_OBJECTS; i++)
-	for (p = list[i]; p != NULL; p = p->piece_link.next) {
-		if (p->ship) ASSERT (in_cargo[p-object]);
+	list = game->changes[UNOWNED];
+	for (i = 0; i < game->nchanged[UNOWNED]; i++) {
+		loc = list[i];
+		game->changed[loc] &= ~(1 << UNOWNED);
+		if (loc < MAP_SIZE) check_cell (loc);
 	}
+	game->nchanged[UNOWNED] = 0;
 }